@@ -0,0 +1,4 @@
+#include "IHaxeExternGenerator.h"
+#include "HaxeExternConfig.h"
+
+const TCHAR *FHaxeExternConfig::SectionName = TEXT("HaxeExternGenerator");
@@ -3,10 +3,14 @@
 #include <CoreUObject.h>
 #include "HaxeGenerator.h"
 #include "HaxeTypes.h"
+#include "HaxeExternConfig.h"
+#include <Containers/Queue.h>
+#include <Misc/SecureHash.h>
 
 DEFINE_LOG_CATEGORY(LogHaxeExtern);
 
 static const FName NAME_ToolTip(TEXT("ToolTip"));
+static const FName NAME_ModuleRelativePath(TEXT("ModuleRelativePath"));
 
 static const FString prelude = TEXT(
   " * \n"
@@ -23,11 +27,150 @@ static const FString prelude2 = TEXT(
   " * This file was autogenerated by UE4HaxeExternGenerator using UHT definitions. It only includes UPROPERTYs and UFUNCTIONs. Do not modify it!\n"
   " * In order to add more definitions, create or edit a type with the same name/package, but with an `_Extra` suffix");
 
+static bool hasEnvFlag(const TCHAR *inName) {
+  TCHAR env[2];
+  FPlatformMisc::GetEnvironmentVariable(inName, env, 2);
+  return *env;
+}
+
+// only used by the cache key when the generator binary can't be hashed. Change this whenever the generated files change
+// for the same input, so entries of older versions aren't restored
+static const TCHAR *CacheVersion = TEXT("1");
+
+// the list of generated files of each cache entry, relative to the entry
+static const TCHAR *CacheFileList = TEXT("files.txt");
+// the list of files written by the last run, relative to the plugin path. A cache hit may only delete these
+static const TCHAR *GeneratedFileList = TEXT("Intermediate/HaxeExternGenerator/GeneratedFiles.txt");
+
+static FString getEnv(const TCHAR *inName) {
+  TCHAR env[4096];
+  FPlatformMisc::GetEnvironmentVariable(inName, env, 4096);
+  return FString(env);
+}
+
+// gets a comma-separated list from the environment variable `inName`
+static TArray<FString> getEnvList(const TCHAR *inName) {
+  TArray<FString> ret;
+  getEnv(inName).ParseIntoArray(ret, TEXT(","), true);
+  for (auto& elem : ret) {
+    elem = elem.Trim().TrimTrailing();
+  }
+  return ret;
+}
+
+// the rendered externs of a class, waiting to be written by the pipeline worker
+struct FHaxeRenderedClass {
+  const ClassDescriptor *cls;
+  FString contents;
+  FString editorOnly;
+};
+
+/**
+ * Background worker used by the pipelined mode (`GENERATE_EXTERNS_PIPELINE`).
+ * Classes of modules that UHT has finished are rendered on the UHT thread, and only their files are compared and written
+ * here, while UHT parses the next modules. The worker never reads reflection data: UHT doesn't synchronize the objects
+ * it creates, and reading metadata may create a package's `UMetaData` object. `ClassDescriptor::haxeType` and the
+ * configuration don't change once the class is rendered, so they are safe to read here
+ **/
+class FHaxePipelineWorker : public FRunnable {
+private:
+  TQueue<FHaxeRenderedClass *, EQueueMode::Spsc> m_queue;
+  TFunction<void (const FHaxeRenderedClass &)> m_write;
+  FThreadSafeCounter m_finishing;
+  // signaled whenever a class is enqueued or the worker should finish
+  FEvent *m_wake;
+  FRunnableThread *m_thread;
+
+public:
+  FHaxePipelineWorker(TFunction<void (const FHaxeRenderedClass &)> inWrite) :
+    m_write(inWrite),
+    m_wake(FPlatformProcess::CreateSynchEvent(false)),
+    m_thread(nullptr)
+  {
+    m_thread = FRunnableThread::Create(this, TEXT("HaxeExternPipeline"));
+  }
+
+  void enqueue(FHaxeRenderedClass *inClass) {
+    m_queue.Enqueue(inClass);
+    m_wake->Trigger();
+  }
+
+  virtual uint32 Run() override {
+    while (true) {
+      // read the flag before draining so nothing enqueued before `finish` is lost
+      bool finishing = m_finishing.GetValue() != 0;
+      FHaxeRenderedClass *cls = nullptr;
+      while (m_queue.Dequeue(cls)) {
+        m_write(*cls);
+        delete cls;
+      }
+      if (finishing) {
+        break;
+      }
+      // the event is auto-reset, so a trigger that happens while draining is kept until this wait
+      m_wake->Wait();
+    }
+    return 0;
+  }
+
+  /**
+   * waits until all queued classes are written
+   **/
+  void finish() {
+    m_finishing.Set(1);
+    m_wake->Trigger();
+    if (m_thread != nullptr) {
+      m_thread->WaitForCompletion();
+      delete m_thread;
+      m_thread = nullptr;
+    }
+  }
+
+  virtual ~FHaxePipelineWorker() {
+    finish();
+    delete m_wake;
+  }
+};
+
+// static_asserts and the headers they need, for a module's `ulayout` header
+struct FLayoutChecks {
+  TArray<FString> includes;
+  FString checks;
+};
+
 class FHaxeExternGenerator : public IHaxeExternGenerator {
 protected:
   FString m_pluginPath;
   FHaxeTypes m_types;
+  FHaxeExternConfig m_config;
+  // false if the configuration doesn't support the current target
+  bool m_enabled = true;
   static FString currentModule;
+  static FString currentTarget;
+
+  // pipelined mode: classes are still rendered on the UHT thread; only their files are written by the worker
+  FHaxePipelineWorker *m_pipeline = nullptr;
+  FString m_lastModule;
+  TSet<const ClassDescriptor *> m_generatedClasses;
+
+  // tree shaking: when set, only the types reachable from these modules, packages or type names are generated
+  TArray<FString> m_roots;
+
+  TMap<const ModuleDescriptor *, FLayoutChecks> m_layoutChecks;
+  // functions that can be called outside the game thread
+  TSet<FString> m_threadSafeFunctions;
+  // the documentation index lines of each Haxe package, when `stripTooltips` is set. The members of an interface
+  // are documented again by every class that implements it, so each line is only kept once
+  TMap<FString, TSet<FString>> m_docs;
+  FHaxeInterfaceFieldCache m_interfaceCache;
+  // the output cache; disabled if empty
+  FString m_cacheDir;
+  // every file generated by this run; see `addToCache` and `pruneStaleFiles`
+  TSet<FString> m_writtenFiles;
+  FCriticalSection m_writtenFilesLock;
+  // the classes exported by UHT, when GENERATE_EXTERNS_MANIFEST is set
+  FHaxeRecordedSource m_recorded;
+  FString m_manifestPath;
 public:
 
   virtual void StartupModule() override {
@@ -36,6 +179,10 @@ public:
 
   virtual void ShutdownModule() override {
     IModularFeatures::Get().UnregisterModularFeature(TEXT("ScriptGenerator"), this);
+    if (m_pipeline != nullptr) {
+      delete m_pipeline;
+      m_pipeline = nullptr;
+    }
   }
 
   /** Name of module that is going to be compiling generated script glue */
@@ -45,29 +192,350 @@ public:
 
   /** Returns true if this plugin supports exporting scripts for the specified target. This should handle game as well as editor target names */
   virtual bool SupportsTarget(const FString& TargetName) const override { 
-    TCHAR env[2];
-    FPlatformMisc::GetEnvironmentVariable(TEXT("GENERATE_EXTERNS"), env, 2);
-    return *env;
+    // the plugin path is only known on `Initialize`, so the per-target configuration is checked there
+    currentTarget = TargetName;
+    return hasEnvFlag(TEXT("GENERATE_EXTERNS"));
   }
   /** Returns true if this plugin supports exporting scripts for the specified module */
   virtual bool ShouldExportClassesForModule(const FString& ModuleName, EBuildModuleType::Type ModuleType, const FString& ModuleGeneratedIncludeDirectory) const override {
     currentModule = ModuleName;
-    return ModuleName != TEXT("HaxeInit");
+    return m_enabled && ModuleName != TEXT("HaxeInit") && m_config.shouldExportModule(ModuleName);
   }
 
   /** Initializes this plugin with build information */
   virtual void Initialize(const FString& RootLocalPath, const FString& RootBuildPath, const FString& OutputDirectory, const FString& IncludeBase) override {
-    this->m_pluginPath = IncludeBase + TEXT("/../../");
-    this->m_types = FHaxeTypes(m_pluginPath);
+    this->setup(IncludeBase + TEXT("/../../"), false);
+    this->m_manifestPath = getEnv(TEXT("GENERATE_EXTERNS_MANIFEST"));
+  }
+
+  virtual void generateFrom(IHaxeReflectionSource &inSource, const FString &inPluginPath, const FString &inTargetName) override {
+    currentTarget = inTargetName;
+    // the classes of the source are already loaded by the calling process, so they were linked by the C++ compiler
+    this->setup(inPluginPath, true);
+    if (!m_enabled) {
+      return;
+    }
+    auto start = FPlatformTime::Seconds();
+    inSource.forEachClass([this](UClass *inClass, const FString &inHeader, const FString &inModule) {
+      if (inModule != TEXT("HaxeInit") && m_config.shouldExportModule(inModule)) {
+        currentModule = inModule;
+        this->ExportClass(inClass, inHeader, FString(), false);
+      }
+    });
+    auto touched = FPlatformTime::Seconds();
+    this->FinishExport();
+    UE_LOG(LogHaxeExtern, Display, TEXT("Touched all classes in %fs, and generated them in %fs"), touched - start, FPlatformTime::Seconds() - touched);
+  }
+
+  /**
+   * resets all state from a previous run, and loads the configuration of `currentTarget`
+   * @see `FHaxeExternConfig::compiledReflection`
+   **/
+  void setup(const FString &inPluginPath, bool inCompiledReflection) {
+    if (m_pipeline != nullptr) {
+      delete m_pipeline;
+      m_pipeline = nullptr;
+    }
+    currentModule = FString();
+    m_lastModule = FString();
+    m_generatedClasses.Reset();
+    m_layoutChecks.Reset();
+    m_threadSafeFunctions.Reset();
+    m_docs.Reset();
+    m_interfaceCache = FHaxeInterfaceFieldCache();
+    m_writtenFiles.Reset();
+    m_recorded = FHaxeRecordedSource();
+    m_manifestPath = FString();
+    this->m_config = FHaxeExternConfig();
+    this->m_config.compiledReflection = inCompiledReflection;
+
+    this->m_pluginPath = inPluginPath;
+    this->m_types.reset(m_pluginPath);
+    this->m_config.load(m_pluginPath / TEXT("Config/HaxeExternGenerator.ini"), currentTarget);
+    this->m_enabled = m_config.supportsTarget(currentTarget);
+    if (!m_enabled) {
+      UE_LOG(LogHaxeExtern, Display, TEXT("Extern generation is disabled for target %s by its configuration"), *currentTarget);
+      return;
+    }
+    this->m_types.setExcludedFilter([this](UPackage *inPackage) {
+      return this->m_config.isPackageExcluded(inPackage);
+    });
+
+    // the environment can enable options that are disabled by the configuration file
+    m_config.emitLayout = m_config.emitLayout || hasEnvFlag(TEXT("GENERATE_EXTERNS_LAYOUT"));
+    if (m_config.emitLayout && !m_config.compiledReflection) {
+      // UHT leaves out every member that isn't a UPROPERTY - including UObjectBase's own - so its sizes and offsets are wrong
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Layout metadata is ignored because UHT doesn't know the compiled layout of its types. Use IHaxeExternGenerator::generateFrom instead"));
+      m_config.emitLayout = false;
+    }
+    m_config.emitCallFrames = m_config.emitCallFrames || hasEnvFlag(TEXT("GENERATE_EXTERNS_CALLFRAMES"));
+    if (m_config.emitCallFrames && !m_config.compiledReflection) {
+      // the parameter offsets depend on the size of struct parameters, and whether they are POD on their computed flags
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Call frame metadata is ignored because UHT doesn't know the compiled layout of its types. Use IHaxeExternGenerator::generateFrom instead"));
+      m_config.emitCallFrames = false;
+    }
+    m_config.emitBoolMasks = m_config.emitBoolMasks || hasEnvFlag(TEXT("GENERATE_EXTERNS_BOOLMASKS"));
+    m_config.emitBulkViews = m_config.emitBulkViews || hasEnvFlag(TEXT("GENERATE_EXTERNS_BULKVIEWS"));
+    m_config.emitContainerLayouts = m_config.emitContainerLayouts || hasEnvFlag(TEXT("GENERATE_EXTERNS_CONTAINER_LAYOUTS"));
+    m_config.emitStructTraits = m_config.emitStructTraits || hasEnvFlag(TEXT("GENERATE_EXTERNS_STRUCT_TRAITS"));
+    if (m_config.emitStructTraits && !m_config.compiledReflection) {
+      // these are STRUCT_ComputedFlags, set from the compiled TStructOpsTypeTraits - which UHT never has
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Struct traits are ignored because UHT doesn't know the compiled traits of its structs. Use IHaxeExternGenerator::generateFrom instead"));
+      m_config.emitStructTraits = false;
+    }
+    m_config.copyPodStructs = m_config.copyPodStructs || hasEnvFlag(TEXT("GENERATE_EXTERNS_COPY_POD_STRUCTS"));
+    if (m_config.copyPodStructs && !m_config.emitStructTraits) {
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Copying POD structs is ignored because struct traits are not emitted"));
+      m_config.copyPodStructs = false;
+    }
+    m_config.emitFunctionTraits = m_config.emitFunctionTraits || hasEnvFlag(TEXT("GENERATE_EXTERNS_FUNCTION_TRAITS"));
+    m_config.splitEditorOnly = m_config.splitEditorOnly || hasEnvFlag(TEXT("GENERATE_EXTERNS_SPLIT_EDITOR"));
+    m_config.stripTooltips = m_config.stripTooltips || hasEnvFlag(TEXT("GENERATE_EXTERNS_STRIP_TOOLTIPS"));
+    m_config.aggregateModules = m_config.aggregateModules || hasEnvFlag(TEXT("GENERATE_EXTERNS_AGGREGATE_MODULES"));
+    m_config.scanConstRefParams = m_config.scanConstRefParams || hasEnvFlag(TEXT("GENERATE_EXTERNS_CONST_REFS"));
+    this->m_types.setScanConstRefParams(m_config.scanConstRefParams);
+    m_config.enumAbstracts = m_config.enumAbstracts || hasEnvFlag(TEXT("GENERATE_EXTERNS_ENUM_ABSTRACTS"));
+    m_config.inferLeafClasses = m_config.inferLeafClasses || hasEnvFlag(TEXT("GENERATE_EXTERNS_INFER_LEAVES"));
+    if (m_config.inferLeafClasses && m_config.filtersModules()) {
+      // the subclasses of a class may be declared on a module that isn't exported
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Leaf class inference is ignored because some modules or packages are not exported"));
+      m_config.inferLeafClasses = false;
+    }
+    this->m_roots = m_config.roots;
+    this->m_roots.Append(getEnvList(TEXT("GENERATE_EXTERNS_ROOTS")));
+    auto cacheDir = getEnv(TEXT("GENERATE_EXTERNS_CACHE"));
+    this->m_cacheDir = cacheDir.IsEmpty() ? m_config.cacheDir : cacheDir;
+    auto usePipeline = m_config.pipeline || hasEnvFlag(TEXT("GENERATE_EXTERNS_PIPELINE"));
+    if (m_roots.Num() > 0 && usePipeline) {
+      // we can only know what is reachable once every module was touched
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Pipelined generation is ignored because tree shaking roots are set"));
+    } else if (m_config.inferLeafClasses && usePipeline) {
+      // classes are generated before we know if they are extended by a later module
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Pipelined generation is ignored because leaf class inference is enabled"));
+    } else if (!m_cacheDir.IsEmpty() && usePipeline) {
+      // the cache key is only known once every module was touched
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Pipelined generation is ignored because the output cache is set"));
+    } else if (usePipeline && FPlatformProcess::SupportsMultithreading()) {
+      UE_LOG(LogHaxeExtern, Log, TEXT("Pipelined extern generation is enabled"));
+      this->m_pipeline = new FHaxePipelineWorker([this](const FHaxeRenderedClass &inClass) {
+        this->saveFile(inClass.cls->haxeType, inClass.contents);
+        this->saveEditorOnlyFile(inClass.cls->haxeType, inClass.editorOnly);
+      });
+    }
   }
 
   /** Exports a single class. May be called multiple times for the same class (as UHT processes the entire hierarchy inside modules. */
   virtual void ExportClass(class UClass* Class, const FString& SourceHeaderFilename, const FString& GeneratedHeaderFilename, bool bHasChanged) override {
-    FString comment = Class->GetMetaData(NAME_ToolTip);
+    if (m_lastModule != currentModule) {
+      // UHT has moved on to another module, so the last one is complete
+      if (m_pipeline != nullptr && !m_lastModule.IsEmpty()) {
+        this->pipelineModule(m_lastModule);
+      }
+      m_lastModule = currentModule;
+    }
     m_types.touchClass(Class, SourceHeaderFilename, currentModule);
+    if (!m_manifestPath.IsEmpty()) {
+      m_recorded.addClass(Class, SourceHeaderFilename, currentModule);
+    }
+  }
+
+  /**
+   * marks `inModuleName` as complete, and renders all classes that can already be generated so the pipeline worker
+   * can write them
+   **/
+  void pipelineModule(const FString &inModuleName) {
+    m_types.completeModule(inModuleName);
+    for (auto module : m_types.getAllModules()) {
+      if (!module->isComplete()) {
+        continue;
+      }
+      for (auto cls : module->getClasses()) {
+        if (!m_generatedClasses.Contains(cls) && m_types.isClassReady(cls)) {
+          m_generatedClasses.Add(cls);
+          generateClassFile(cls);
+        }
+      }
+    }
+  }
+
+  void generateClassFile(const ClassDescriptor *inClass) {
+    auto gen = FHaxeGenerator(this->m_types, this->m_pluginPath, this->m_config);
+    gen.setInterfaceCache(&m_interfaceCache);
+    gen.generateClass(inClass);
+    m_threadSafeFunctions.Append(gen.getThreadSafeFunctions());
+    addDocs(gen.getDocs());
+
+    auto pack = inClass->uclass->GetOuterUPackage();
+    TArray<FString> includes;
+    includes.Push(FHaxeGenerator::getHeaderPath(pack, inClass->header));
+    addLayoutChecks(m_types.getModule(pack), includes, gen.getLayoutChecks());
+
+    if (m_pipeline != nullptr) {
+      auto rendered = new FHaxeRenderedClass();
+      rendered->cls = inClass;
+      rendered->contents = gen.toString();
+      rendered->editorOnly = gen.getEditorOnlyExtern();
+      m_pipeline->enqueue(rendered);
+    } else {
+      saveFile(inClass->haxeType, gen.toString());
+      saveEditorOnlyFile(inClass->haxeType, gen.getEditorOnlyExtern());
+    }
+  }
+
+  /**
+   * writes the `umodules/<Module>.h` headers. Each one first includes the headers of the modules it depends on,
+   * and then only the headers that weren't included by them yet - with the headers of super classes before
+   * the headers of their subclasses. Since every header is included only once, they can all be aggregated into
+   * `umodules/AllModules.h`, which can be used as a precompiled header
+   **/
+  void writeModuleHeaders() {
+    auto modules = m_types.getAllModules();
+    // the order of getAllModules is not deterministic
+    modules.Sort([](const ModuleDescriptor &a, const ModuleDescriptor &b) {
+      return a.moduleName < b.moduleName;
+    });
+
+    TMap<const ModuleDescriptor *, TArray<FString>> ownHeaders;
+    TMap<const ModuleDescriptor *, TArray<const ModuleDescriptor *>> deps;
+    for (auto module : modules) {
+      TSet<const ClassDescriptor *> visited;
+      TArray<FString> headers;
+      TArray<const ModuleDescriptor *> moduleDeps;
+      for (auto cls : module->getClasses()) {
+        addClassHeaders(module, cls, visited, headers, moduleDeps);
+      }
+      ownHeaders.Add(module, headers);
+      deps.Add(module, moduleDeps);
+    }
+
+    TArray<const ModuleDescriptor *> order;
+    TSet<const ModuleDescriptor *> visitedModules;
+    for (auto module : modules) {
+      addModuleInOrder(module, deps, visitedModules, order);
+    }
+
+    auto dir = this->m_pluginPath / TEXT("Haxe/Templates/Source/HaxeRuntime/Generated/umodules/");
+    if (!IFileManager::Get().DirectoryExists(*dir)) {
+      IFileManager::Get().MakeDirectory(*dir, true);
+    }
+
+    // all headers that each module header includes, directly or through its dependencies
+    TMap<const ModuleDescriptor *, TSet<FString>> included;
+    TSet<FString> allHeaders;
+    auto all = FHelperBuf();
+    all << Comment(prelude + TEXT(" * This header was automatically generated by UE4HaxeExternGenerator.\n * It includes all UCLASS/USTRUCT/UENUM definitions of all modules, and can be used as a precompiled header"));
+    all << TEXT("#pragma once\n\n");
+    for (auto module : order) {
+      TSet<FString> moduleIncluded;
+      auto buf = FHelperBuf();
+      buf << Comment(prelude + TEXT(" * This header was automatically generated by UE4HaxeExternGenerator.\n * It includes all UCLASS/USTRUCT/UENUM definitions for module ") + module->moduleName);
+      buf << TEXT("#pragma once\n\n");
+      auto& moduleDeps = deps[module];
+      for (auto dep : moduleDeps) {
+        auto depIncluded = included.Find(dep);
+        if (depIncluded != nullptr) {
+          moduleIncluded.Append(*depIncluded);
+          buf << TEXT("#include \"") << Escaped(dep->moduleName) << TEXT(".h\"") << Newline();
+        }
+      }
+      if (moduleDeps.Num() > 0) {
+        buf << Newline();
+      }
+      for (auto &header : ownHeaders[module]) {
+        if (!moduleIncluded.Contains(header)) {
+          moduleIncluded.Add(header);
+          buf << TEXT("#include <") << Escaped(header) << TEXT(">") << Newline();
+        }
+        if (!allHeaders.Contains(header)) {
+          allHeaders.Add(header);
+          all << TEXT("#include <") << Escaped(header) << TEXT(">") << Newline();
+        }
+      }
+      included.Add(module, moduleIncluded);
+
+      saveFile(dir / module->moduleName + TEXT(".h"), buf.toString());
+    }
+
+    if (m_config.aggregateModules) {
+      saveFile(dir / TEXT("AllModules.h"), all.toString());
+    }
+    LOG("%d unique headers were included by %d module headers", allHeaders.Num(), order.Num());
+  }
+
+  // adds the header of `inClass` to `outHeaders`, after the headers of its supers and interfaces that belong to the same module
+  void addClassHeaders(const ModuleDescriptor *inModule, const ClassDescriptor *inClass, TSet<const ClassDescriptor *> &visited,
+      TArray<FString> &outHeaders, TArray<const ModuleDescriptor *> &outDeps) {
+    if (visited.Contains(inClass)) {
+      return;
+    }
+    visited.Add(inClass);
+
+    auto uclass = inClass->uclass;
+    TArray<UClass *> bases;
+    for (auto super = uclass->GetSuperClass(); super != nullptr; super = super->GetSuperClass()) {
+      if (m_types.getDescriptor(super) != nullptr) {
+        // the first exported super already depends on the ones before it
+        bases.Push(super);
+        break;
+      }
+    }
+    for (auto& impl : uclass->Interfaces) {
+      bases.Push(impl.Class);
+    }
+    for (auto base : bases) {
+      auto descr = m_types.getDescriptor(base);
+      if (descr == nullptr) {
+        continue;
+      }
+      auto module = m_types.getModule(base->GetOuterUPackage());
+      if (module == inModule) {
+        addClassHeaders(inModule, descr, visited, outHeaders, outDeps);
+      } else {
+        outDeps.AddUnique(module);
+      }
+    }
+    outHeaders.AddUnique(FHaxeGenerator::getHeaderPath(uclass->GetOuterUPackage(), inClass->header));
+  }
+
+  void addModuleInOrder(const ModuleDescriptor *inModule, const TMap<const ModuleDescriptor *, TArray<const ModuleDescriptor *>> &inDeps,
+      TSet<const ModuleDescriptor *> &visited, TArray<const ModuleDescriptor *> &outOrder) {
+    if (visited.Contains(inModule)) {
+      return;
+    }
+    visited.Add(inModule);
+    auto moduleDeps = inDeps.Find(inModule);
+    if (moduleDeps != nullptr) {
+      for (auto dep : *moduleDeps) {
+        addModuleInOrder(dep, inDeps, visited, outOrder);
+      }
+    }
+    outOrder.Push(inModule);
+  }
+
+  void addDocs(const TArray<FHaxeDocEntry> &inDocs) {
+    for (auto& entry : inDocs) {
+      auto line = FHelperBuf();
+      line << entry.key << TEXT("\t") << Escaped(entry.doc);
+      m_docs.FindOrAdd(entry.package).Add(line.toString());
+    }
+  }
+
+  void addLayoutChecks(const ModuleDescriptor *inModule, const TArray<FString> &inIncludes, const FString &inChecks) {
+    if (inChecks.IsEmpty()) {
+      return;
+    }
+    auto& checks = m_layoutChecks.FindOrAdd(inModule);
+    for (auto& include : inIncludes) {
+      checks.includes.AddUnique(include);
+    }
+    checks.checks += inChecks;
   }
 
   void saveFile(const FString& file, const FString& contents) {
+    {
+      FScopeLock lock(&m_writtenFilesLock);
+      m_writtenFiles.Add(file);
+    }
     FString lastContents;
     if (!FFileHelper::LoadFileToString(lastContents, *file, 0) || lastContents != contents) {
       if (!FFileHelper::SaveStringToFile(contents, *file, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM)) {
@@ -79,53 +547,479 @@ public:
   }
 
   void saveFile(const FHaxeTypeRef& inHaxeType, const FString& contents) {
+    auto root = TEXT("Haxe/Externs");
+    if (m_config.splitEditorOnly && isEditorPackage(inHaxeType)) {
+      // game targets don't have the editor externs in their class path
+      m_types.deleteFileIfExists(inHaxeType);
+      root = TEXT("Haxe/EditorExterns");
+    }
+    saveFile(inHaxeType, inHaxeType.name, root, contents);
+  }
+
+  void saveFile(const FHaxeTypeRef& inHaxeType, const FString& inName, const TCHAR *inRoot, const FString& contents) {
     auto& fileMan = IFileManager::Get();
-    auto outPath = this->m_pluginPath / TEXT("Haxe/Externs") / FString::Join(inHaxeType.pack, TEXT("/"));
+    auto outPath = this->m_pluginPath / inRoot / FString::Join(inHaxeType.pack, TEXT("/"));
     if (!fileMan.DirectoryExists(*outPath)) {
       fileMan.MakeDirectory(*outPath, true);
     }
 
-    auto file = outPath / inHaxeType.name + TEXT(".hx");
+    auto file = outPath / inName + TEXT(".hx");
     saveFile(file, contents);
   }
 
+  void saveEditorOnlyFile(const FHaxeTypeRef& inHaxeType, const FString& contents) {
+    if (!contents.IsEmpty()) {
+      saveFile(inHaxeType, inHaxeType.name + TEXT("_EditorOnly"), TEXT("Haxe/EditorExterns"), contents);
+    } else {
+      // the type may have lost its editor-only members, or `splitEditorOnly` was turned off; a stale extern
+      // would still be merged into the type
+      m_types.deleteFileIfExists(inHaxeType, TEXT("Haxe/EditorExterns"), TEXT("_EditorOnly"));
+    }
+  }
+
+  static bool isEditorPackage(const FHaxeTypeRef& inHaxeType) {
+    return inHaxeType.pack.Num() >= 2 && inHaxeType.pack[0] == TEXT("unreal") && inHaxeType.pack[1] == TEXT("editor");
+  }
+
   /** Called once all classes have been exported */
   virtual void FinishExport() override {
+    if (!m_enabled) {
+      return;
+    }
+    if (!m_manifestPath.IsEmpty()) {
+      // can be replayed with `FHaxeManifestSource`
+      if (m_recorded.saveManifest(m_manifestPath)) {
+        UE_LOG(LogHaxeExtern, Display, TEXT("Saved %d classes to the manifest %s"), m_recorded.num(), *m_manifestPath);
+      } else {
+        UE_LOG(LogHaxeExtern, Error, TEXT("Cannot write the manifest %s"), *m_manifestPath);
+      }
+    }
+    if (m_pipeline != nullptr) {
+      m_pipeline->finish();
+      delete m_pipeline;
+      m_pipeline = nullptr;
+      LOG("%d classes were generated by the pipeline", m_generatedClasses.Num());
+    }
+
+    FString cacheKey;
+    auto start = FPlatformTime::Seconds();
+    if (!m_cacheDir.IsEmpty()) {
+      cacheKey = getCacheKey();
+      if (restoreFromCache(cacheKey)) {
+        saveGeneratedFileList();
+        addCacheStats(TEXT("hit"), cacheKey, FPlatformTime::Seconds() - start);
+        return;
+      }
+    }
+
+    if (m_config.inferLeafClasses) {
+      // every module was touched, so we now know which classes are never extended
+      auto leaves = m_types.computeHierarchy();
+      LOG("%d classes have no subclasses", leaves);
+    }
+
+    TSet<UField *> reachable;
+    int32 pruned = 0;
+    auto shouldGenerate = [&](UField *inField, const FHaxeTypeRef &inType) {
+      if (m_roots.Num() == 0 || reachable.Contains(inField)) {
+        return true;
+      }
+      // make sure we don't leave a stale extern from a previous run behind
+      m_types.deleteGeneratedFiles(inType);
+      pruned++;
+      return false;
+    };
+    if (m_roots.Num() > 0) {
+      reachable = m_types.getReachableTypes(m_roots);
+    }
+
     // now start generating
     for (auto& cls : m_types.getAllClasses()) {
-      auto gen = FHaxeGenerator(this->m_types, this->m_pluginPath);
-      gen.generateClass(cls);
-      saveFile(cls->haxeType, gen.toString());
+      if (!m_generatedClasses.Contains(cls) && shouldGenerate(cls->uclass, cls->haxeType)) {
+        generateClassFile(cls);
+      }
     }
 
     for (auto& s : m_types.getAllStructs()) {
-      auto gen = FHaxeGenerator(this->m_types, this->m_pluginPath);
+      if (!shouldGenerate(s->ustruct, s->haxeType)) {
+        continue;
+      }
+      auto gen = FHaxeGenerator(this->m_types, this->m_pluginPath, this->m_config);
       gen.generateStruct(s);
       saveFile(s->haxeType, gen.toString());
+      saveEditorOnlyFile(s->haxeType, gen.getEditorOnlyExtern());
+      addDocs(gen.getDocs());
+
+      TArray<FString> includes;
+      for (auto& header : s->getHeaders()) {
+        includes.Push(FHaxeGenerator::getHeaderPath(s->module->getPackage(), header));
+      }
+      addLayoutChecks(s->module, includes, gen.getLayoutChecks());
     }
 
     for (auto& uenum : m_types.getAllEnums()) {
-      auto gen = FHaxeGenerator(this->m_types, this->m_pluginPath);
+      if (!shouldGenerate(uenum->uenum, uenum->haxeType)) {
+        continue;
+      }
+      auto gen = FHaxeGenerator(this->m_types, this->m_pluginPath, this->m_config);
       gen.generateEnum(uenum);
       saveFile(uenum->haxeType, gen.toString());
+      addDocs(gen.getDocs());
     }
 
-    for (auto module : m_types.getAllModules()) {
+    for (auto& delegate : m_types.getAllDelegates()) {
+      if (!shouldGenerate(delegate->signature, delegate->haxeType)) {
+        continue;
+      }
+      auto gen = FHaxeGenerator(this->m_types, this->m_pluginPath, this->m_config);
+      if (gen.generateDelegate(delegate)) {
+        saveFile(delegate->haxeType, gen.toString());
+        addDocs(gen.getDocs());
+      } else {
+        // it may have been supported by a previous run
+        m_types.deleteGeneratedFiles(delegate->haxeType);
+      }
+    }
+
+    LOG("Interface fields were reused %d times and generated %d times", m_interfaceCache.hits, m_interfaceCache.misses);
+    if (m_roots.Num() > 0) {
+      UE_LOG(LogHaxeExtern, Display, TEXT("Tree shaking: %d types are reachable from the roots (%s); %d types were pruned"),
+          reachable.Num(), *FString::Join(m_roots, TEXT(", ")), pruned);
+    }
+
+    writeModuleHeaders();
+
+    if (m_config.emitFunctionTraits) {
+      auto functions = m_threadSafeFunctions.Array();
+      functions.Sort();
       auto buf = FHelperBuf();
-      buf << Comment(prelude + TEXT(" * This header was automatically generated by UE4HaxeExternGenerator.\n * It includes all UCLASS/USTRUCT/UENUM definitions for module ") + module->moduleName);
+      buf << TEXT("# This file was automatically generated by UE4HaxeExternGenerator.") << Newline();
+      buf << TEXT("# These functions were declared as BlueprintThreadSafe, and can be called outside the game thread") << Newline();
+      for (auto& func : functions) {
+        buf << func << Newline();
+      }
+      saveFile(this->m_pluginPath / TEXT("Haxe/Externs/ThreadSafeFunctions.txt"), buf.toString());
+      UE_LOG(LogHaxeExtern, Display, TEXT("%d functions are thread-safe"), functions.Num());
+    }
+
+    if (m_config.stripTooltips) {
+      auto dir = this->m_pluginPath / TEXT("Haxe/Docs/");
+      if (!IFileManager::Get().DirectoryExists(*dir)) {
+        IFileManager::Get().MakeDirectory(*dir, true);
+      }
+      for (auto& elem : m_docs) {
+        // one `<key>\t<escaped tooltip>` line per documented type or member, sorted so the files only change with the docs
+        auto lines = elem.Value.Array();
+        lines.Sort();
+        auto path = dir / (elem.Key.IsEmpty() ? FString(TEXT("_root")) : elem.Key) + TEXT(".txt");
+        saveFile(path, FString::Join(lines, TEXT("\n")) + TEXT("\n"));
+      }
+    }
+
+    for (auto& elem : m_layoutChecks) {
+      auto buf = FHelperBuf();
+      buf << Comment(prelude + TEXT(" * This header was automatically generated by UE4HaxeExternGenerator.\n * It checks that the @:ulayout metadata of module ") + elem.Key->moduleName + TEXT(" matches the C++ definitions"));
       buf << TEXT("#pragma once\n\n");
-      for (auto &header : module->headerOrder) {
-        buf << TEXT("#include <") << Escaped(FHaxeGenerator::getHeaderPath(module->getPackage(), header)) << TEXT(">") << Newline();
+      for (auto &header : elem.Value.includes) {
+        buf << TEXT("#include <") << Escaped(header) << TEXT(">") << Newline();
       }
+      buf << Newline() << elem.Value.checks;
 
-      auto dir = this->m_pluginPath / TEXT("Haxe/Templates/Source/HaxeRuntime/Generated/umodules/");
+      auto dir = this->m_pluginPath / TEXT("Haxe/Templates/Source/HaxeRuntime/Generated/ulayout/");
       if (!IFileManager::Get().DirectoryExists(*dir)) {
         IFileManager::Get().MakeDirectory(*dir, true);
       }
+      saveFile(dir / elem.Key->moduleName + TEXT(".h"), buf.toString());
+    }
+
+    if (m_roots.Num() > 0) {
+      // these are written per package or per module, so pruning all types of a package or module leaves their files behind
+      pruneStaleFiles(TEXT("Haxe/Docs"));
+      pruneStaleFiles(TEXT("Haxe/Templates/Source/HaxeRuntime/Generated/umodules"));
+      pruneStaleFiles(TEXT("Haxe/Templates/Source/HaxeRuntime/Generated/ulayout"));
+    }
+
+    LOG("Memory used by the type descriptors:\n%s", *m_types.getMemoryReport());
+
+    saveGeneratedFileList();
+    if (!cacheKey.IsEmpty()) {
+      addToCache(cacheKey);
+      addCacheStats(TEXT("miss"), cacheKey, FPlatformTime::Seconds() - start);
+    }
+  }
+
+  /**
+   * deletes the files of `inDir` - relative to the plugin path - that were not written by this run
+   **/
+  void pruneStaleFiles(const TCHAR *inDir) {
+    auto dir = m_pluginPath / inDir;
+    TSet<FString> written;
+    {
+      FScopeLock lock(&m_writtenFilesLock);
+      for (auto& file : m_writtenFiles) {
+        if (getOutputPath(FPaths::GetPath(file)) == inDir) {
+          written.Add(FPaths::GetCleanFilename(file));
+        }
+      }
+    }
+    TArray<FString> files;
+    IFileManager::Get().FindFiles(files, *(dir / TEXT("*.*")), true, false);
+    for (auto& file : files) {
+      if (!written.Contains(file)) {
+        LOG("Deleting stale file %s", *(dir / file));
+        IFileManager::Get().Delete(*(dir / file));
+      }
+    }
+  }
 
-      auto path = dir / module->moduleName + TEXT(".h");
-      saveFile(path, buf.toString());
+  // the path of a generated file relative to the plugin path, without duplicate or trailing slashes
+  FString getOutputPath(const FString &inFile) const {
+    auto ret = inFile.RightChop(m_pluginPath.Len()).Replace(TEXT("\\"), TEXT("/"));
+    while (ret.Contains(TEXT("//"))) {
+      ret = ret.Replace(TEXT("//"), TEXT("/"));
+    }
+    while (ret.StartsWith(TEXT("/"))) {
+      ret = ret.RightChop(1);
+    }
+    while (ret.EndsWith(TEXT("/"))) {
+      ret = ret.LeftChop(1);
     }
+    return ret;
+  }
+
+  /**
+   * a hash of everything the generated files depend on: the generator binary, the engine version, the configuration,
+   * the contents of the headers that declare the touched classes, structs and enums, and the reflection data of
+   * structs, enums and delegates - including what UHT computes from the C++ code, like their struct flags and layout
+   **/
+  FString getCacheKey() {
+    FMD5 md5;
+    auto add = [&md5](const FString &inStr) {
+      FTCHARToUTF8 utf8(*inStr);
+      md5.Update((const uint8 *) utf8.Get(), utf8.Length());
+      md5.Update((const uint8 *) "\n", 1);
+    };
+    auto addFile = [&md5](const FString &inPath) {
+      TArray<uint8> contents;
+      if (!inPath.IsEmpty() && FFileHelper::LoadFileToArray(contents, *inPath, FILEREAD_Silent)) {
+        md5.Update(contents.GetData(), contents.Num());
+        return true;
+      }
+      return false;
+    };
+
+    // any change to the generator itself may change its output
+    FModuleStatus status;
+    if (!FModuleManager::Get().QueryModule(TEXT("UE4HaxeExternGenerator"), status) || !addFile(status.FilePath)) {
+      UE_LOG(LogHaxeExtern, Warning, TEXT("Cannot find the generator binary. The cache key will only depend on its version"));
+      add(CacheVersion);
+    }
+    add(FString::Printf(TEXT("%d.%d.%d"), ENGINE_MAJOR_VERSION, ENGINE_MINOR_VERSION, ENGINE_PATCH_VERSION));
+    add(m_config.describe());
+    add(FString::Join(m_roots, TEXT(",")));
+
+    // the absolute header paths are different on each machine, so they are keyed by their module and relative path
+    TArray<FString> entries;
+    TMap<FString, FString> headers;
+    TMap<UPackage *, FString> moduleDirs;
+    for (auto cls : m_types.getAllClasses()) {
+      auto pack = cls->uclass->GetOuterUPackage();
+      auto include = FHaxeGenerator::getHeaderPath(pack, cls->header);
+      entries.Push(cls->uclass->GetPathName() + TEXT(" ") + include);
+      headers.Add(pack->GetName() + TEXT(":") + include, *cls->header);
+
+      // headers that only declare structs or enums are never passed to us, but they can be found relative to the module
+      auto& relative = cls->uclass->GetMetaData(NAME_ModuleRelativePath);
+      if (!moduleDirs.Contains(pack) && !relative.IsEmpty() && FPaths::GetCleanFilename(relative) == FPaths::GetCleanFilename(cls->header)) {
+        moduleDirs.Add(pack, FString(cls->header).LeftChop(relative.Len()));
+      }
+    }
+    auto addTypeHeader = [&](UField *inField) {
+      auto& relative = inField->GetMetaData(NAME_ModuleRelativePath);
+      auto dir = moduleDirs.Find(inField->GetOutermost());
+      if (!relative.IsEmpty() && dir != nullptr) {
+        headers.Add(inField->GetOutermost()->GetName() + TEXT(":") + relative, *dir + relative);
+      }
+    };
+    for (auto s : m_types.getAllStructs()) {
+      auto ustruct = s->ustruct;
+      auto super = ustruct->GetSuperStruct();
+      entries.Push(ustruct->GetPathName() + FString::Printf(TEXT(" flags=%x size=%d align=%d super=%s"),
+          (uint32) ustruct->StructFlags, ustruct->GetStructureSize(), ustruct->GetMinAlignment(), super != nullptr ? *super->GetPathName() : TEXT("")) +
+          getFieldsDigest(ustruct));
+      addTypeHeader(ustruct);
+    }
+    for (auto e : m_types.getAllEnums()) {
+      auto digest = e->uenum->GetPathName();
+      for (int i = 0; i < e->uenum->NumEnums(); i++) {
+        digest += FString::Printf(TEXT(" %s=%lld"), *e->uenum->GetEnumName(i), (long long int) FHaxeGenerator::getEnumValue(e->uenum, i));
+      }
+      entries.Push(digest + getMetaDataDigest(e->uenum));
+      addTypeHeader(e->uenum);
+    }
+    for (auto d : m_types.getAllDelegates()) {
+      entries.Push(d->signature->GetPathName() + FString::Printf(TEXT(" size=%d ret=%d"), (int32) d->signature->ParmsSize, (int32) d->signature->ReturnValueOffset) +
+          getFieldsDigest(d->signature));
+    }
+    entries.Sort();
+    for (auto& entry : entries) {
+      add(entry);
+    }
+
+    headers.KeySort(TLess<FString>());
+    for (auto& header : headers) {
+      add(header.Key);
+      addFile(header.Value);
+    }
+
+    uint8 digest[16];
+    md5.Final(digest);
+    return BytesToHex(digest, 16);
+  }
+
+  static FString getFieldsDigest(UStruct *inStruct) {
+    FString ret = getMetaDataDigest(inStruct);
+    for (TFieldIterator<UProperty> props(inStruct, EFieldIteratorFlags::ExcludeSuper); props; ++props) {
+      ret += FString::Printf(TEXT(" %s:%s:%llx:%d:%d:%d:%d"), *props->GetName(), *props->GetCPPType(), (unsigned long long) props->PropertyFlags,
+          props->ArrayDim, props->ElementSize, props->GetOffset_ForUFunction(), props->GetMinAlignment());
+      ret += getMetaDataDigest(*props);
+    }
+    return ret;
+  }
+
+  static FString getMetaDataDigest(UObject *inObj) {
+    FString ret;
+    auto metaMap = UMetaData::GetMapForObject(inObj);
+    if (metaMap != nullptr) {
+      TArray<FString> entries;
+      for (auto& meta : *metaMap) {
+        entries.Push(meta.Key.ToString() + TEXT("=") + meta.Value);
+      }
+      entries.Sort();
+      ret += TEXT(" {") + FString::Join(entries, TEXT(";")) + TEXT("}");
+    }
+    return ret;
+  }
+
+  /**
+   * restores the files of a cache entry one by one. Files that a previous run generated but that are not in the entry are
+   * deleted, so files of pruned, moved or removed types don't survive - but files the generator doesn't own (like
+   * hand-written `_Extra` types) are never touched
+   **/
+  bool restoreFromCache(const FString &inKey) {
+    auto& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+    auto entry = m_cacheDir / inKey;
+    TArray<FString> files;
+    if (!loadFileList(entry / CacheFileList, files)) {
+      return false;
+    }
+    for (auto& file : files) {
+      if (!platformFile.FileExists(*(entry / file))) {
+        UE_LOG(LogHaxeExtern, Warning, TEXT("The cache entry %s is missing %s. Generating the externs instead"), *entry, *file);
+        return false;
+      }
+    }
+
+    TSet<FString> restored(files);
+    TArray<FString> previous;
+    if (loadFileList(m_pluginPath / GeneratedFileList, previous)) {
+      for (auto& file : previous) {
+        if (!restored.Contains(file) && platformFile.FileExists(*(m_pluginPath / file))) {
+          LOG("Deleting previously generated file %s", *file);
+          platformFile.DeleteFile(*(m_pluginPath / file));
+        }
+      }
+    }
+    for (auto& file : files) {
+      auto cached = entry / file, output = m_pluginPath / file;
+      TArray<uint8> cachedContents, outputContents;
+      if (FFileHelper::LoadFileToArray(cachedContents, *cached, FILEREAD_Silent) &&
+          FFileHelper::LoadFileToArray(outputContents, *output, FILEREAD_Silent) && cachedContents == outputContents) {
+        // keep the timestamp, so nothing that depends on it is rebuilt
+        continue;
+      }
+      if (!platformFile.CreateDirectoryTree(*FPaths::GetPath(output)) || !platformFile.CopyFile(*output, *cached)) {
+        UE_LOG(LogHaxeExtern, Warning, TEXT("Cannot restore %s from the cache entry %s. Generating the externs instead"), *file, *entry);
+        return false;
+      }
+    }
+
+    FScopeLock lock(&m_writtenFilesLock);
+    m_writtenFiles.Reset();
+    for (auto& file : files) {
+      m_writtenFiles.Add(m_pluginPath / file);
+    }
+    return true;
+  }
+
+  /**
+   * adds the files written by this run - and only them, as the output directories may have stale files
+   * from previous runs - to the cache, together with their list
+   **/
+  void addToCache(const FString &inKey) {
+    auto& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+    auto entry = m_cacheDir / inKey;
+    if (platformFile.DirectoryExists(*entry)) {
+      return;
+    }
+    // other agents may be sharing the cache, so the entry is written to a temporary directory and then renamed
+    auto temp = entry + TEXT(".") + FGuid::NewGuid().ToString();
+    auto files = getWrittenFileList();
+    auto ok = true;
+    for (auto& file : files) {
+      auto cached = temp / file;
+      ok = platformFile.CreateDirectoryTree(*FPaths::GetPath(cached)) && platformFile.CopyFile(*cached, *(m_pluginPath / file));
+      if (!ok) {
+        break;
+      }
+    }
+    ok = ok && FFileHelper::SaveStringToFile(FString::Join(files, TEXT("\n")) + TEXT("\n"), *(temp / CacheFileList));
+    if (!ok || !platformFile.MoveFile(*entry, *temp)) {
+      if (!platformFile.DirectoryExists(*entry)) {
+        UE_LOG(LogHaxeExtern, Warning, TEXT("Cannot add the generated files to the cache at %s"), *entry);
+      }
+      platformFile.DeleteDirectoryRecursively(*temp);
+    }
+  }
+
+  // the files written by this run, relative to the plugin path and sorted
+  TArray<FString> getWrittenFileList() {
+    TArray<FString> ret;
+    FScopeLock lock(&m_writtenFilesLock);
+    for (auto& file : m_writtenFiles) {
+      if (!file.StartsWith(m_pluginPath)) {
+        UE_LOG(LogHaxeExtern, Warning, TEXT("Generated file %s is outside the plugin directory"), *file);
+        continue;
+      }
+      ret.Push(getOutputPath(file));
+    }
+    ret.Sort();
+    return ret;
+  }
+
+  /**
+   * records the files written by this run, so the next cache hit knows which files it may delete
+   **/
+  void saveGeneratedFileList() {
+    auto files = getWrittenFileList();
+    FFileHelper::SaveStringToFile(FString::Join(files, TEXT("\n")) + TEXT("\n"), *(m_pluginPath / GeneratedFileList));
+  }
+
+  static bool loadFileList(const FString &inPath, TArray<FString> &outFiles) {
+    FString contents;
+    if (!FFileHelper::LoadFileToString(contents, *inPath)) {
+      return false;
+    }
+    contents.ParseIntoArrayLines(outFiles);
+    return true;
+  }
+
+  void addCacheStats(const TCHAR *inResult, const FString &inKey, double inSeconds) {
+    UE_LOG(LogHaxeExtern, Display, TEXT("Extern cache %s for key %s (%fs)"), inResult, *inKey, inSeconds);
+    // one line per run, so the hit rate of the cache can be followed over time
+    auto line = FString::Printf(TEXT("%s %s %s %f\n"), *FDateTime::UtcNow().ToIso8601(), inResult, *inKey, inSeconds);
+    FFileHelper::SaveStringToFile(line, *(m_cacheDir / TEXT("stats.log")), FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM,
+        &IFileManager::Get(), FILEWRITE_Append);
   }
 
   /** Name of the generator plugin, mostly for debuggind purposes */
@@ -138,6 +1032,7 @@ public:
 IMPLEMENT_MODULE(FHaxeExternGenerator, UE4HaxeExternGenerator)
 
 FString FHaxeExternGenerator::currentModule = FString();
+FString FHaxeExternGenerator::currentTarget = FString();
 
 FString FHaxeGenerator::getHeaderPath(UPackage *inPack, const FString& inPath) {
   if (inPath.IsEmpty()) {
@@ -186,6 +1081,15 @@ void FHaxeGenerator::generateFields(UStruct *inStruct, bool onlyProps = false) {
   if (inStruct->IsA<UClass>()) {
     uclass = Cast<UClass>(inStruct);
   }
+  // the documentation index keys the fields by the type that declares them
+  const FHaxeTypeRef *docType = nullptr;
+  if (uclass != nullptr) {
+    auto descr = m_haxeTypes.getDescriptor(uclass);
+    docType = descr != nullptr ? &descr->haxeType : nullptr;
+  } else if (inStruct->IsA<UScriptStruct>()) {
+    auto descr = m_haxeTypes.getDescriptor(Cast<UScriptStruct>(inStruct));
+    docType = descr != nullptr ? &descr->haxeType : nullptr;
+  }
   auto wasEditorOnly = false;
   TArray<UField *> fields;
   for (TFieldIterator<UField> invFields(inStruct, EFieldIteratorFlags::ExcludeSuper); invFields; ++invFields) {
@@ -196,13 +1100,17 @@ void FHaxeGenerator::generateFields(UStruct *inStruct, bool onlyProps = false) {
     auto field = fields.Pop(false);
     if (field->IsA<UProperty>()) {
       auto prop = Cast<UProperty>(field);
-      if (prop->HasAnyPropertyFlags(CPF_Protected) && prop->IsA<UBoolProperty>()) {
-        continue; // we cannot generate code for protected bit-fields
+      if (prop->HasAnyPropertyFlags(CPF_Protected) && prop->IsA<UBoolProperty>() && !m_config.emitBoolMasks) {
+        continue; // we cannot generate glue code for protected bit-fields; they need the @:ubool masked access
       }
       FString type;
       if ((prop->HasAnyFlags(RF_Public) || prop->HasAnyPropertyFlags(CPF_Protected)) && upropType(prop, type)) {
         auto isEditorOnly = prop->HasAnyPropertyFlags(CPF_EditorOnly);
-        if (isEditorOnly != wasEditorOnly) {
+        auto splitEditorOnly = isEditorOnly && m_config.splitEditorOnly;
+        if (splitEditorOnly) {
+          // written to its own extern, so game targets never have to parse it
+          this->swapEditorOnly();
+        } else if (isEditorOnly != wasEditorOnly) {
           if (isEditorOnly) {
             m_buf << TEXT("#if WITH_EDITORONLY_DATA") << Newline();
           } else {
@@ -210,14 +1118,26 @@ void FHaxeGenerator::generateFields(UStruct *inStruct, bool onlyProps = false) {
           }
           wasEditorOnly = isEditorOnly;
         }
-        auto& propComment = prop->GetMetaData(NAME_ToolTip);
-        if (!propComment.IsEmpty()) {
-          m_buf << Comment(propComment);
-        }
+        this->addDoc(docType, prop->GetNameCPP(), prop->GetMetaData(NAME_ToolTip));
 
         if (prop->HasAnyPropertyFlags( CPF_Deprecated )) {
           // properties can still be accessed without annoying warnings. So let's generate them and add @:deprecated on the Haxe side
-          m_buf << "@:deprecated ";
+          m_buf << TEXT("@:deprecated ");
+        }
+        this->generatePropertyLayout(prop);
+        FString bulkView;
+        if (m_config.emitBulkViews && getBulkView(prop, m_config.compiledReflection, bulkView)) {
+          m_buf << TEXT("@:ubulkView(") << bulkView << TEXT(") ");
+        }
+        if (prop->ArrayDim > 1) {
+          m_buf << TEXT("@:ufixedArray(") << FString::FromInt(prop->ArrayDim) << TEXT(", ") << FString::FromInt(prop->ElementSize) << TEXT(") ");
+        }
+        FString containerLayout;
+        if (m_config.emitContainerLayouts && getContainerLayout(prop, containerLayout)) {
+          m_buf << containerLayout << TEXT(" ");
+        }
+        if (m_config.emitBoolMasks && prop->IsA<UBoolProperty>()) {
+          this->generateBoolMask(Cast<UBoolProperty>(prop));
         }
         auto readOnly = prop->HasAnyPropertyFlags(CPF_ConstParm);
         m_buf 
@@ -227,6 +1147,9 @@ void FHaxeGenerator::generateFields(UStruct *inStruct, bool onlyProps = false) {
         // TODO see if the property is read-only; this might not be supported by UHT atm?
         // if (prop->HasAnyPropertyFlags( CPF_Con
         m_buf << TEXT(" : ") << type << TEXT(";") << Newline();
+        if (splitEditorOnly) {
+          this->swapEditorOnly();
+        }
       }
     } else if (field->IsA<UFunction>()) {
       if (onlyProps) {
@@ -241,22 +1164,35 @@ void FHaxeGenerator::generateFields(UStruct *inStruct, bool onlyProps = false) {
         continue;
       } else if (func->HasAnyFunctionFlags(FUNC_Private | FUNC_Delegate)) {
         // we can't access private functions
-        // Delegate signatures are a weird piece of code that don't seem to be exported
+        // Delegate signatures are generated as their own types (see `generateDelegate`)
         continue;
       }
       this->m_generatedFields.Add(func->GetName());
       // we need to create a local buffer because we will only know if we should
       // generate this function in the end of its processing
       FHelperBuf curBuf;
+      if (m_config.emitCallFrames) {
+        this->generateCallFrame(func, curBuf);
+      }
+      for (TFieldIterator<UProperty> params(func); m_config.emitBulkViews && params; ++params) {
+        FString bulkView;
+        if (!params->HasAnyPropertyFlags(CPF_ReturnParm) && getBulkView(*params, m_config.compiledReflection, bulkView)) {
+          curBuf << TEXT("@:ubulkViewArg(\"") << params->GetNameCPP() << TEXT("\", ") << bulkView << TEXT(") ");
+        }
+      }
 
       if (func->HasAnyFunctionFlags(FUNC_Const)) {
         curBuf << TEXT("@:thisConst ");
       }
+      if (m_config.emitFunctionTraits) {
+        this->generateFunctionTraits(func, curBuf);
+      }
 
       LOG("Generating %s (flags %x)", *func->GetName(), func->FunctionFlags);
       if (func->HasAnyFunctionFlags(FUNC_Static)) {
         curBuf << TEXT("static ");
-      } else if (func->HasAnyFunctionFlags(FUNC_Final)) {
+      } else if (func->HasAnyFunctionFlags(FUNC_Final) || (uclass != nullptr && uclass->HasAnyClassFlags(CLASS_Final) && !uclass->HasAnyClassFlags(CLASS_Interface))) {
+        // functions of final classes can't be overridden either
         curBuf << TEXT("@:final ");
       }
       curBuf << (func->HasAnyFunctionFlags(FUNC_Public) ? TEXT("public function ") : TEXT("private function ")) << func->GetName() << TEXT("(");
@@ -291,10 +1227,8 @@ void FHaxeGenerator::generateFields(UStruct *inStruct, bool onlyProps = false) {
           wasEditorOnly = false;
           m_buf << TEXT("#end // WITH_EDITORONLY_DATA") << Newline();
         }
-        auto& fnComment = func->GetMetaData(NAME_ToolTip);
-        if (!fnComment.IsEmpty()) {
-          m_buf << Comment(fnComment);
-        }
+        this->addDoc(docType, func->GetName(), func->GetMetaData(NAME_ToolTip));
+        this->addThreadSafeFunction(func);
         m_buf << curBuf.toString() << Newline();
       }
     } else {
@@ -307,6 +1241,224 @@ void FHaxeGenerator::generateFields(UStruct *inStruct, bool onlyProps = false) {
   }
 }
 
+void FHaxeGenerator::generateTypeLayout(UStruct *inStruct, const FString &inCppName, int32 inSize) {
+  m_layoutOwner = inStruct;
+  m_layoutOwnerCpp = inCppName;
+  if (!m_config.emitLayout) {
+    return;
+  }
+
+  // editor-only properties change the layout of everything that comes after them, so the metadata
+  // of these types is only valid with WITH_EDITORONLY_DATA
+  auto hasEditorOnlyData = false;
+  for (TFieldIterator<UProperty> props(inStruct, EFieldIteratorFlags::IncludeSuper); props; ++props) {
+    if (props->HasAnyPropertyFlags(CPF_EditorOnly)) {
+      hasEditorOnlyData = true;
+      break;
+    }
+  }
+  m_layoutEditorOnly = hasEditorOnlyData;
+  if (hasEditorOnlyData) {
+    m_layoutChecks << TEXT("#if WITH_EDITORONLY_DATA") << Newline();
+  }
+  auto size = FString::FromInt(inSize);
+  auto align = FString::FromInt(inStruct->GetMinAlignment());
+  m_buf << TEXT("@:ulayout(") << size << TEXT(", ") << align << TEXT(")") << Newline();
+  if (hasEditorOnlyData) {
+    m_buf << TEXT("@:ulayoutEditorOnly") << Newline();
+  }
+  m_layoutChecks << TEXT("static_assert(sizeof(") << inCppName << TEXT(") == ") << size
+    << TEXT(", \"The size of ") << inCppName << TEXT(" has changed. Please regenerate the externs\");") << Newline();
+  m_layoutChecks << TEXT("static_assert(alignof(") << inCppName << TEXT(") == ") << align
+    << TEXT(", \"The alignment of ") << inCppName << TEXT(" has changed. Please regenerate the externs\");") << Newline();
+}
+
+void FHaxeGenerator::generatePropertyLayout(UProperty *inProp) {
+  if (!m_config.emitLayout || m_layoutOwner == nullptr || inProp->GetOwnerStruct() != m_layoutOwner) {
+    // fields that come from interfaces don't belong to the type's layout
+    return;
+  }
+  auto offset = FString::FromInt(inProp->GetOffset_ForUFunction());
+  m_buf << TEXT("@:ulayout(") << offset << TEXT(", ") << FString::FromInt(inProp->ElementSize) << TEXT(", ") << FString::FromInt(inProp->GetMinAlignment()) << TEXT(") ");
+
+  // we can't use offsetof on protected fields or bit-fields
+  auto boolProp = Cast<UBoolProperty>(inProp);
+  if (inProp->HasAnyPropertyFlags(CPF_Protected) || (boolProp != nullptr && !boolProp->IsNativeBool())) {
+    return;
+  }
+  auto name = m_layoutOwnerCpp + TEXT("::") + inProp->GetNameCPP();
+  auto isEditorOnly = inProp->HasAnyPropertyFlags(CPF_EditorOnly);
+  if (isEditorOnly) {
+    m_layoutChecks << TEXT("#if WITH_EDITORONLY_DATA") << Newline();
+  }
+  m_layoutChecks << TEXT("static_assert(STRUCT_OFFSET(") << m_layoutOwnerCpp << TEXT(", ") << inProp->GetNameCPP() << TEXT(") == ") << offset
+    << TEXT(", \"The offset of ") << name << TEXT(" has changed. Please regenerate the externs\");") << Newline();
+  m_layoutChecks << TEXT("static_assert(sizeof(") << name << TEXT(") == ") << FString::FromInt(inProp->GetSize())
+    << TEXT(", \"The size of ") << name << TEXT(" has changed. Please regenerate the externs\");") << Newline();
+  if (isEditorOnly) {
+    m_layoutChecks << TEXT("#endif") << Newline();
+  }
+}
+
+void FHaxeGenerator::endTypeLayout() {
+  if (m_layoutEditorOnly) {
+    m_layoutChecks << TEXT("#endif // WITH_EDITORONLY_DATA") << Newline();
+  }
+  m_layoutOwner = nullptr;
+  m_layoutEditorOnly = false;
+}
+
+void FHaxeGenerator::generateCallFrame(UFunction *inFunc, FHelperBuf &outBuf) {
+  auto isPod = true;
+  FHelperBuf paramsBuf;
+  auto first = true;
+  for (TFieldIterator<UProperty> params(inFunc); params; ++params) {
+    auto param = *params;
+    if (!param->HasAnyPropertyFlags(CPF_IsPlainOldData)) {
+      // needs to be constructed and destroyed
+      isPod = false;
+    }
+    if (param->HasAnyPropertyFlags(CPF_ReturnParm)) {
+      continue;
+    }
+    if (first) first = false; else paramsBuf << TEXT(", ");
+    paramsBuf << TEXT("[") << FString::FromInt(param->GetOffset_ForUFunction()) << TEXT(", ") << FString::FromInt(param->GetSize()) << TEXT("]");
+  }
+  auto returnOffset = inFunc->ReturnValueOffset == MAX_uint16 ? -1 : (int32) inFunc->ReturnValueOffset;
+
+  outBuf << TEXT("@:uframe(") << FString::FromInt(inFunc->ParmsSize) << TEXT(", ") << FString::FromInt(returnOffset) << TEXT(", ")
+    << (isPod ? TEXT("true") : TEXT("false")) << TEXT(") ");
+  if (!first) {
+    outBuf << TEXT("@:uparams(") << paramsBuf << TEXT(") ");
+  }
+}
+
+void FHaxeGenerator::addDoc(const FHaxeTypeRef *inType, const FString &inMember, const FString &inDoc) {
+  if (inDoc.IsEmpty()) {
+    return;
+  }
+  if (!m_config.stripTooltips || inType == nullptr) {
+    m_buf << Comment(inDoc);
+    return;
+  }
+  FHaxeDocEntry entry;
+  entry.package = FString::Join(inType->pack, TEXT("."));
+  entry.key = inMember.IsEmpty() ? inType->toString() : inType->toString() + TEXT(".") + inMember;
+  entry.doc = inDoc;
+  m_docs.Push(entry);
+}
+
+void FHaxeGenerator::swapEditorOnly() {
+  if (!m_hasEditorOnly) {
+    // same indentation as the type body
+    m_editorOnlyBuf.begin(TEXT(""));
+    m_hasEditorOnly = true;
+  }
+  Swap(m_buf, m_editorOnlyBuf);
+}
+
+void FHaxeGenerator::generateEditorOnlyExtern(const FHaxeTypeRef &inType) {
+  if (!m_hasEditorOnly) {
+    return;
+  }
+  FHelperBuf buf;
+  buf << Comment(prelude + TEXT(" * This file was autogenerated by UE4HaxeExternGenerator using UHT definitions.\n * It includes the editor-only properties of ") + inType.toString());
+  if (inType.pack.Num() > 0) {
+    buf << TEXT("package ") << FString::Join(inType.pack, TEXT(".")) << TEXT(";") << Newline() << Newline();
+  }
+  // the Haxe runtime must merge these into the original type; the generator only writes them
+  buf << TEXT("@:ueditorOnlyFor(") << inType.toString() << TEXT(")") << Newline();
+  buf << TEXT("@:uextern extern class ") << inType.name << TEXT("_EditorOnly") << Begin(TEXT(" {"));
+  buf.addBlock(m_editorOnlyBuf);
+  buf << End();
+  m_editorOnlyExtern = buf.toString();
+}
+
+void FHaxeGenerator::generateFunctionTraits(UFunction *inFunc, FHelperBuf &outBuf) {
+  if (inFunc->HasAnyFunctionFlags(FUNC_BlueprintPure)) {
+    outBuf << TEXT("@:upure ");
+  }
+  if (inFunc->HasAnyFunctionFlags(FUNC_Native)) {
+    // implemented in C++, as opposed to Blueprint events
+    outBuf << TEXT("@:unative ");
+  }
+  if (isThreadSafe(inFunc)) {
+    outBuf << TEXT("@:uthreadSafe ");
+  }
+}
+
+void FHaxeGenerator::addThreadSafeFunction(UFunction *inFunc) {
+  if (!m_config.emitFunctionTraits || !isThreadSafe(inFunc)) {
+    return;
+  }
+  auto descr = m_haxeTypes.getDescriptor(inFunc->GetOwnerClass());
+  if (descr != nullptr) {
+    m_threadSafeFunctions.Push(descr->haxeType.toString() + TEXT(".") + inFunc->GetName());
+  }
+}
+
+bool FHaxeGenerator::isThreadSafe(UFunction *inFunc) {
+  static const FName threadSafe = TEXT("BlueprintThreadSafe");
+  static const FName notThreadSafe = TEXT("NotBlueprintThreadSafe");
+  if (inFunc->HasMetaData(threadSafe)) {
+    return true;
+  }
+  // the class metadata applies to all its functions, unless they opt out of it
+  auto owner = inFunc->GetOwnerClass();
+  return owner != nullptr && owner->HasMetaData(threadSafe) && !inFunc->HasMetaData(notThreadSafe);
+}
+
+void FHaxeGenerator::generateBoolMask(UBoolProperty *inProp) {
+  if (inProp->IsNativeBool()) {
+    // a whole byte. Its offset computed by UHT only counts the UPROPERTYs before it, so like for bit-fields
+    // the runtime must read it from the compiled UBoolProperty
+    m_buf << TEXT("@:ubool(true) ");
+  } else {
+    // UHT can't know the bit position of a bit-field, since it depends on the C++ compiler.
+    // The compiled UBoolProperty knows it, so the runtime must read its byte offset and field mask once
+    m_buf << TEXT("@:ubool(false) ");
+  }
+}
+
+bool FHaxeGenerator::getBulkView(UProperty *inProp, bool inCompiledReflection, FString &outArgs) {
+  auto arrayProp = Cast<UArrayProperty>(inProp);
+  if (arrayProp == nullptr) {
+    return false;
+  }
+  auto inner = arrayProp->Inner;
+  // object pointers are plain old data, but they must be seen by the GC
+  if (!inner->HasAnyPropertyFlags(CPF_IsPlainOldData) || inner->IsA<UObjectPropertyBase>()) {
+    return false;
+  }
+  auto structProp = Cast<UStructProperty>(inner);
+  if (structProp != nullptr && (!inCompiledReflection || (structProp->Struct->StructFlags & STRUCT_IsPlainOldData) == 0)) {
+    // UHT knows neither the size of a struct nor if it's POD; only numbers are supported there
+    return false;
+  }
+  // TArray elements can't be static arrays, so the element size is also the stride
+  outArgs = FString::FromInt(inner->ElementSize) + TEXT(", ") + FString::FromInt(inner->GetMinAlignment());
+  return true;
+}
+
+bool FHaxeGenerator::getContainerLayout(UProperty *inProp, FString &outMeta) {
+#if HAXE_HAS_MAP_KEY_OFFSET
+  if (inProp->IsA<UMapProperty>()) {
+    auto& layout = Cast<UMapProperty>(inProp)->MapLayout;
+    outMeta = FString::Printf(TEXT("@:umapLayout(%d, %d, %d, %d, %d)"),
+        layout.KeyOffset, layout.ValueOffset, layout.SetLayout.Size, layout.SetLayout.HashNextIdOffset, layout.SetLayout.HashIndexOffset);
+    return true;
+  }
+#endif
+#if HAXE_HAS_SET_PROPERTY
+  if (inProp->IsA<USetProperty>()) {
+    auto& layout = Cast<USetProperty>(inProp)->SetLayout;
+    outMeta = FString::Printf(TEXT("@:usetLayout(%d, %d, %d)"), layout.Size, layout.HashNextIdOffset, layout.HashIndexOffset);
+    return true;
+  }
+#endif
+  return false;
+}
+
 void FHaxeGenerator::collectSuperFields(UStruct *inSuper) {
   for (TFieldIterator<UField> fields(inSuper, EFieldIteratorFlags::IncludeSuper); fields; ++fields) {
     auto field = *fields;
@@ -319,7 +1471,7 @@ bool FHaxeGenerator::generateClass(const ClassDescriptor *inClass) {
   m_buf << Comment(prelude + prelude2);
 
   if (hxType.pack.Num() > 0) {
-    m_buf << TEXT("package ") << FString::Join(hxType.pack, TEXT(".")) << ";" << Newline() << Newline();
+    m_buf << TEXT("package ") << FString::Join(hxType.pack, TEXT(".")) << TEXT(";") << Newline() << Newline();
   }
   
   auto isInterface = hxType.kind == ETypeKind::KUInterface;
@@ -328,18 +1480,27 @@ bool FHaxeGenerator::generateClass(const ClassDescriptor *inClass) {
   bool isMinimalAPI = (uclass->ClassFlags & CLASS_MinimalAPI);
   auto shouldNotExport = isMinimalAPI || (!uclass->HasAnyClassFlags( CLASS_RequiredAPI | CLASS_MinimalAPI ) && !inClass->header.IsEmpty() && uclass->GetName() != TEXT("Object"));
   // comment
-  auto comment = uclass->GetMetaData(NAME_ToolTip);
+  FString warnings;
   if (isNoExport) {
-    comment = TEXT("WARNING: This type is defined as NoExport by UHT. It will be empty because of it\n\n") + comment;
+    warnings = TEXT("WARNING: This type is defined as NoExport by UHT. It will be empty because of it\n\n") + warnings;
   }
   if (isMinimalAPI) {
-    comment = TEXT("WARNING: This type was defined as MinimalAPI on its declaration. Because of that, its properties/methods are inaccessible\n\n") + comment;
+    warnings = TEXT("WARNING: This type was defined as MinimalAPI on its declaration. Because of that, its properties/methods are inaccessible\n\n") + warnings;
   } else if (shouldNotExport) {
-    comment = TEXT("WARNING: This type was not defined as DLL export on its declaration. Because of that, its properties/methods are inaccessible\n\n") + comment;
+    warnings = TEXT("WARNING: This type was not defined as DLL export on its declaration. Because of that, its properties/methods are inaccessible\n\n") + warnings;
   }
 
-  if (!comment.IsEmpty()) {
-    m_buf << Comment(comment);
+  if (m_config.stripTooltips) {
+    // the warnings are not documentation, so they stay on the extern
+    if (!warnings.IsEmpty()) {
+      m_buf << Comment(warnings.LeftChop(2));
+    }
+    this->addDoc(&hxType, FString(), uclass->GetMetaData(NAME_ToolTip));
+  } else {
+    auto comment = warnings + uclass->GetMetaData(NAME_ToolTip);
+    if (!comment.IsEmpty()) {
+      m_buf << Comment(comment);
+    }
   }
   // @:umodule
   if (!hxType.module.IsEmpty()) {
@@ -347,9 +1508,20 @@ bool FHaxeGenerator::generateClass(const ClassDescriptor *inClass) {
   }
   // @:glueCppIncludes
   m_buf << TEXT("@:glueCppIncludes(\"") << Escaped(getHeaderPath(inClass->uclass->GetOuterUPackage(), inClass->header)) << TEXT("\")") << Newline();
+  if (!isInterface) {
+    this->generateTypeLayout(uclass, hxType.name, uclass->GetPropertiesSize());
+  }
   if (shouldNotExport && !isMinimalAPI) {
     m_buf << TEXT("@:noClass ");
   }
+  if (!isInterface) {
+    if (uclass->HasAnyClassFlags(CLASS_Final)) {
+      m_buf << TEXT("@:final ");
+    } else if (m_haxeTypes.isLeafClass(uclass)) {
+      // no exported class extends it, but Haxe or Blueprint classes still can
+      m_buf << TEXT("@:uleaf ");
+    }
+  }
 
   m_buf << TEXT("@:uextern extern ") << (isInterface ? TEXT("interface ") : TEXT("class ")) << hxType.name;
   if (!isInterface) {
@@ -369,7 +1541,7 @@ bool FHaxeGenerator::generateClass(const ClassDescriptor *inClass) {
 
       if (super != nullptr) {
         this->collectSuperFields(superUClass);
-        m_buf << " extends " << super->haxeType.toString();
+        m_buf << TEXT(" extends ") << super->haxeType.toString();
       }
     }
   }
@@ -391,14 +1563,42 @@ bool FHaxeGenerator::generateClass(const ClassDescriptor *inClass) {
     }
     for (auto& impl : uclass->Interfaces) {
       m_buf << TEXT("// ") << impl.Class->GetName() << TEXT(" interface implementation") << Newline();
-      this->generateFields(impl.Class);
+      this->generateInterfaceFields(impl.Class);
     }
   }
   m_buf << End();
+  this->endTypeLayout();
+  this->generateEditorOnlyExtern(hxType);
   printf("%s\n", TCHAR_TO_UTF8(*m_buf.toString()));
   return true;
 }
 
+void FHaxeGenerator::generateInterfaceFields(UClass *inInterface) {
+  if (m_interfaceCache == nullptr) {
+    this->generateFields(inInterface);
+    return;
+  }
+  auto cached = m_interfaceCache->find(inInterface);
+  if (cached == nullptr) {
+    auto gen = FHaxeGenerator(m_haxeTypes, m_basePath, m_config);
+    // same indentation as the class body
+    gen.m_buf.begin(TEXT(""));
+    gen.generateFields(inInterface);
+    cached = &m_interfaceCache->add(inInterface, gen.m_buf, gen.m_generatedFields);
+    m_threadSafeFunctions.Append(gen.m_threadSafeFunctions);
+    m_docs.Append(gen.m_docs);
+  }
+  for (auto& name : cached->names) {
+    if (m_generatedFields.Contains(name)) {
+      // the class already declares one of the interface functions, so the shared block doesn't apply
+      this->generateFields(inInterface);
+      return;
+    }
+  }
+  m_buf.addBlock(cached->fields);
+  m_generatedFields.Append(cached->names);
+}
+
 void FHaxeGenerator::generateIncludeMetas(const NonClassDescriptor *inDesc) {
   m_buf << TEXT("@:glueCppIncludes(");
   auto first = true;
@@ -414,20 +1614,27 @@ bool FHaxeGenerator::generateStruct(const StructDescriptor *inStruct) {
   m_buf << Comment(prelude + prelude2);
 
   if (hxType.pack.Num() > 0) {
-    m_buf << TEXT("package ") << FString::Join(hxType.pack, TEXT(".")) << ";" << Newline() << Newline();
+    m_buf << TEXT("package ") << FString::Join(hxType.pack, TEXT(".")) << TEXT(";") << Newline() << Newline();
   }
   
   auto ustruct = inStruct->ustruct;
   // comment
   bool isNoExport = (ustruct->StructFlags & STRUCT_NoExport) != 0;
   auto isNotRequired = (ustruct->StructFlags & STRUCT_RequiredAPI) == 0;
-  auto comment = ustruct->GetMetaData(NAME_ToolTip);
-  if (isNoExport || isNotRequired) {
-    comment = TEXT("WARNING: This type is defined as NoExport by UHT. It will be empty because of it\n\n") + comment;
-  }
-
-  if (!comment.IsEmpty()) {
-    m_buf << Comment(comment);
+  auto& tooltip = ustruct->GetMetaData(NAME_ToolTip);
+  if (m_config.stripTooltips) {
+    if (isNoExport || isNotRequired) {
+      m_buf << Comment(TEXT("WARNING: This type is defined as NoExport by UHT. It will be empty because of it"));
+    }
+    this->addDoc(&hxType, FString(), tooltip);
+  } else {
+    auto comment = tooltip;
+    if (isNoExport || isNotRequired) {
+      comment = TEXT("WARNING: This type is defined as NoExport by UHT. It will be empty because of it\n\n") + comment;
+    }
+    if (!comment.IsEmpty()) {
+      m_buf << Comment(comment);
+    }
   }
   // @:umodule
   if (!hxType.module.IsEmpty()) {
@@ -435,9 +1642,30 @@ bool FHaxeGenerator::generateStruct(const StructDescriptor *inStruct) {
   }
   // @:glueCppIncludes
   generateIncludeMetas(inStruct);
+  this->generateTypeLayout(ustruct, hxType.name, ustruct->GetStructureSize());
+  // traits that allow the runtime to use memcpy/memset/memcmp instead of going through the glue code
+  auto isPod = m_config.emitStructTraits && (ustruct->StructFlags & STRUCT_IsPlainOldData) != 0;
+  if (m_config.emitStructTraits) {
+    if (isPod) {
+      m_buf << TEXT("@:upod ");
+    }
+    if (ustruct->StructFlags & STRUCT_ZeroConstructor) {
+      m_buf << TEXT("@:uzeroConstructor ");
+    }
+    if (ustruct->StructFlags & STRUCT_NoDestructor) {
+      m_buf << TEXT("@:unoDestructor ");
+    }
+    if (ustruct->StructFlags & STRUCT_CopyNative) {
+      m_buf << TEXT("@:ucopyNative ");
+    }
+    if (ustruct->StructFlags & STRUCT_IdenticalNative) {
+      m_buf << TEXT("@:uidenticalNative ");
+    }
+  }
   if (isNotRequired) {
     // we don't know if == or the copy constructors are inline or not
-    m_buf << TEXT("@:noCopy @:noEquals ");
+    // POD types can always be copied with memcpy, so they don't need the copy constructor - if the runtime does that
+    m_buf << (isPod && m_config.copyPodStructs ? TEXT("@:noEquals ") : TEXT("@:noCopy @:noEquals "));
   }
   m_buf << TEXT("@:uextern extern ") << TEXT("class ") << hxType.name;
 
@@ -454,7 +1682,7 @@ bool FHaxeGenerator::generateStruct(const StructDescriptor *inStruct) {
       }
     }
     if (nullptr != super) {
-      m_buf << " extends " << super->haxeType.toString();
+      m_buf << TEXT(" extends ") << super->haxeType.toString();
     }
   }
   m_buf << Begin(TEXT(" {"));
@@ -464,23 +1692,97 @@ bool FHaxeGenerator::generateStruct(const StructDescriptor *inStruct) {
     }
   }
   m_buf << End();
+  this->endTypeLayout();
+  this->generateEditorOnlyExtern(hxType);
   printf("%s\n", TCHAR_TO_UTF8(*m_buf.toString()));
   return true;
 }
 
+bool FHaxeGenerator::isDelegateSupported(const DelegateDescriptor *inDelegate) {
+  auto known = m_haxeTypes.findDelegateSupport(inDelegate);
+  if (known != nullptr) {
+    return *known;
+  }
+  // assume it is while its arguments are checked, in case they reference the delegate itself
+  m_haxeTypes.setDelegateSupport(inDelegate, true);
+  for (TFieldIterator<UProperty> params(inDelegate->signature); params; ++params) {
+    FString type;
+    if (!upropType(*params, type)) {
+      LOG("Delegate %s: argument %s is not supported", *inDelegate->signature->GetName(), *params->GetName());
+      m_haxeTypes.setDelegateSupport(inDelegate, false);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FHaxeGenerator::generateDelegate(const DelegateDescriptor *inDelegate) {
+  if (!isDelegateSupported(inDelegate)) {
+    return false;
+  }
+  auto signature = inDelegate->signature;
+  // the Haxe function type of the delegate
+  FString args, ret = TEXT("Void");
+  FHelperBuf paramNames;
+  for (TFieldIterator<UProperty> params(signature); params; ++params) {
+    auto param = *params;
+    FString type;
+    upropType(param, type);
+    if (param->HasAnyPropertyFlags(CPF_ReturnParm)) {
+      ret = type;
+    } else {
+      if (!args.IsEmpty()) paramNames << TEXT(", ");
+      args += type + TEXT("->");
+      paramNames << TEXT("\"") << param->GetNameCPP() << TEXT("\"");
+    }
+  }
+  if (args.IsEmpty()) {
+    args = TEXT("Void->");
+  }
+
+  m_buf << Comment(prelude + prelude2);
+  auto hxType = inDelegate->haxeType;
+  if (hxType.pack.Num() > 0) {
+    m_buf << TEXT("package ") << FString::Join(hxType.pack, TEXT(".")) << TEXT(";") << Newline() << Newline();
+  }
+
+  // comment
+  this->addDoc(&hxType, FString(), signature->GetMetaData(NAME_ToolTip));
+  // @:umodule
+  if (!hxType.module.IsEmpty()) {
+    m_buf << TEXT("@:umodule(\"") << Escaped(hxType.module) << TEXT("\")") << Newline();
+  }
+  // @:glueCppIncludes
+  generateIncludeMetas(inDelegate);
+  if (inDelegate->isNested()) {
+    m_buf << TEXT("@:uname(\"") << Escaped(DelegateDescriptor::getCppName(signature).Replace(TEXT("::"), TEXT("."))) << TEXT("\")") << Newline();
+  }
+  // the parameters frame layout allows the runtime to call typed thunks without going through reflection
+  if (m_config.emitCallFrames) {
+    this->generateCallFrame(signature, m_buf);
+    m_buf << Newline();
+  }
+  if (!paramNames.toString().IsEmpty()) {
+    m_buf << TEXT("@:uparamNames(") << paramNames << TEXT(")") << Newline();
+  }
+
+  m_buf << TEXT("@:uextern extern class ") << hxType.name << TEXT(" extends ")
+    << (inDelegate->isMulticast() ? TEXT("unreal.DynamicMulticastDelegate<") : TEXT("unreal.DynamicDelegate<"))
+    << hxType.name << TEXT(", ") << args << ret << TEXT(">") << Begin(TEXT(" {"));
+  m_buf << End();
+  return true;
+}
+
 bool FHaxeGenerator::generateEnum(const EnumDescriptor *inEnum) {
   auto uenum = inEnum->uenum;
   m_buf << Comment(prelude + prelude2);
   auto hxType = inEnum->haxeType;
   if (hxType.pack.Num() > 0) {
-    m_buf << TEXT("package ") << FString::Join(hxType.pack, TEXT(".")) << ";" << Newline() << Newline();
+    m_buf << TEXT("package ") << FString::Join(hxType.pack, TEXT(".")) << TEXT(";") << Newline() << Newline();
   }
 
   // comment
-  auto& comment = uenum->GetMetaData(NAME_ToolTip);
-  if (!comment.IsEmpty()) {
-    m_buf << Comment(comment);
-  }
+  this->addDoc(&hxType, FString(), uenum->GetMetaData(NAME_ToolTip));
   // @:umodule
   if (!hxType.module.IsEmpty()) {
     m_buf << TEXT("@:umodule(\"") << Escaped(hxType.module) << TEXT("\")") << Newline();
@@ -493,13 +1795,38 @@ bool FHaxeGenerator::generateEnum(const EnumDescriptor *inEnum) {
     m_buf << TEXT("@:class ");
   }
 
-  m_buf << TEXT("@:uextern extern ") << TEXT("enum ") << hxType.name;
-  
+  if (m_config.enumAbstracts) {
+    // the actual C++ values, so converting from and to C++ costs nothing
+    m_buf << TEXT("@:uextern @:enum abstract ") << hxType.name << TEXT("(Int) from Int to Int");
+  } else {
+    m_buf << TEXT("@:uextern extern ") << TEXT("enum ") << hxType.name;
+  }
+
+  // read all the entries' metadata in a single pass, instead of looking up `<Entry>.ToolTip` and `<Entry>.DisplayName` for each one
+  TMap<FString, FString> tooltips, displayNames;
+  auto metaMap = UMetaData::GetMapForObject(uenum);
+  if (metaMap != nullptr) {
+    static const FString toolTipKey = TEXT("ToolTip");
+    static const FString displayNameKey = TEXT("DisplayName");
+    for (auto& meta : *metaMap) {
+      FString entry, key;
+      if (meta.Key.ToString().Split(TEXT("."), &entry, &key, ESearchCase::CaseSensitive, ESearchDir::FromEnd)) {
+        if (key == toolTipKey) {
+          tooltips.Add(entry, meta.Value);
+        } else if (key == displayNameKey) {
+          displayNames.Add(entry, meta.Value);
+        }
+      }
+    }
+  }
+
   m_buf << Begin(TEXT(" {"));
   for (int i = 0; i < uenum->NumEnums() - 1; i++) {
     auto name = uenum->GetEnumName(i);
-    auto ecomment = uenum->GetMetaData(FName(*(name + TEXT(".") + TEXT("ToolTip"))));
-    auto displayName = uenum->GetMetaData(FName(*(name + TEXT(".") + TEXT("DisplayName"))));
+    auto tooltip = tooltips.Find(name);
+    auto displayNamePtr = displayNames.Find(name);
+    auto ecomment = tooltip != nullptr ? *tooltip : FString();
+    auto displayName = displayNamePtr != nullptr ? *displayNamePtr : FString();
     if (!displayName.IsEmpty()) {
       if (ecomment.IsEmpty()) {
         ecomment = displayName;
@@ -507,14 +1834,16 @@ bool FHaxeGenerator::generateEnum(const EnumDescriptor *inEnum) {
         ecomment += TEXT("\n@DisplayName ") + displayName;
       }
     }
-    if (!ecomment.IsEmpty()) {
-      m_buf << Comment(ecomment);
-    }
+    this->addDoc(&hxType, name, ecomment);
 
     if (!displayName.IsEmpty()) {
-      m_buf << TEXT("@DisplayName(\"") << Escaped(displayName) << "\")" << Newline();
+      m_buf << TEXT("@DisplayName(\"") << Escaped(displayName) << TEXT("\")") << Newline();
+    }
+    if (m_config.enumAbstracts) {
+      m_buf << TEXT("var ") << name << TEXT(" = ") << FString::Printf(TEXT("%lld"), (long long int) getEnumValue(uenum, i)) << TEXT(";") << Newline();
+    } else {
+      m_buf << name << TEXT(";") << Newline();
     }
-    m_buf << name << TEXT(";") << Newline();
   }
 
   m_buf << End();
@@ -529,10 +1858,17 @@ bool FHaxeGenerator::generateEnum(const EnumDescriptor *inEnum) {
   return true;
 }
 
+int64 FHaxeGenerator::getEnumValue(UEnum *inEnum, int32 inIndex) {
+#if ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 16
+  return inEnum->GetValueByIndex(inIndex);
+#else
+  return inEnum->GetValueByName(inEnum->GetEnum(inIndex));
+#endif
+}
+
 bool FHaxeGenerator::writeWithModifiers(const FString &inName, UProperty *inProp, FString &outType) {
   if (inProp->ArrayDim > 1) {
-    // TODO: support array dimensions (e.g. SomeType SomeProp[8])
-    return false;
+    return writeFixedArray(inName, inProp, outType);
   }
   auto end = FString();
   // check all the flags that interest us
@@ -561,23 +1897,52 @@ bool FHaxeGenerator::writeWithModifiers(const FString &inName, UProperty *inProp
   }
 
   // UHT bug: it doesn't provide any way to differentiate `const SomeType&` to `SomeType`
-  // so we'll assume it's always the latter - which is more common
-  // if (inProp->HasAnyPropertyFlags(CPF_Parm) && end.IsEmpty()) {
-  //   outType += TEXT("unreal.Const<unreal.PRef<") + inName + TEXT(">>");
-  //   return true;
-  // }
+  // so unless the declaration tells us otherwise, we'll assume it's always the latter - which is more common
+  if (inProp->HasAnyPropertyFlags(CPF_Parm) && end.IsEmpty() && isConstRefParam(inProp)) {
+    outType += TEXT("unreal.Const<unreal.PRef<") + inName + TEXT(">>");
+    return true;
+  }
   LOG("PROPERTY %s: %s %llx", *inName, *outType, (long long int) inProp->PropertyFlags);
 
   outType += inName + end;
   return true;
 }
 
+bool FHaxeGenerator::isConstRefParam(UProperty *inParam) {
+  if (inParam->IsA<UObjectPropertyBase>() || inParam->HasAnyPropertyFlags(CPF_ReturnParm)) {
+    return false;
+  }
+  auto func = Cast<UFunction>(inParam->GetOuter());
+  if (func == nullptr) {
+    return false;
+  }
+  auto descr = m_haxeTypes.getDescriptor(func->GetOwnerClass());
+  if (descr == nullptr) {
+    return false;
+  }
+  auto key = func->GetName() + TEXT(".") + inParam->GetName();
+  return descr->constRefParams.Contains(key) || m_config.constRefParams.Contains(descr->haxeType.name + TEXT(".") + key);
+}
+
 bool FHaxeGenerator::writeBasicWithModifiers(const FString &inName, UProperty *inProp, FString &outType) {
+  if (inProp->ArrayDim > 1) {
+    return writeFixedArray(inName, inProp, outType);
+  }
   // TODO support basic types' modifiers
   outType += inName;
   return true;
 }
 
+bool FHaxeGenerator::writeFixedArray(const FString &inName, UProperty *inProp, FString &outType) {
+  // static arrays (e.g. SomeType SomeProp[8]) can only be UPROPERTYs, so they never have parameter modifiers.
+  // Their element count and size are added as @:ufixedArray by `generateFields`
+  if (inProp->HasAnyPropertyFlags(CPF_Parm)) {
+    return false;
+  }
+  outType += TEXT("unreal.FixedArray<") + inName + TEXT(">");
+  return true;
+}
+
 static bool canBuildTArrayProp(FString inInner, UProperty *inProp) {
   // HACK: we need this since some types struggle with some operators (e.g. set operator)
   //       we'll need to find a better way to deal with this, but for now we'll just not include that into the built
@@ -620,6 +1985,38 @@ bool FHaxeGenerator::upropType(UProperty* inProp, FString &outType) {
       return false;
     }
     return writeWithModifiers(descr->haxeType.toString(), inProp, outType);
+  } else if (inProp->IsA<UObjectPropertyBase>()) {
+    // weak, lazy and soft pointers: these don't keep the object (or its assets) loaded
+    auto prop = Cast<UObjectPropertyBase>(inProp);
+    const TCHAR *wrapper = nullptr;
+    UClass *uclass = prop->PropertyClass;
+    if (inProp->IsA<UWeakObjectProperty>()) {
+      wrapper = TEXT("unreal.TWeakObjectPtr<");
+    } else if (inProp->IsA<ULazyObjectProperty>()) {
+      wrapper = TEXT("unreal.TLazyObjectPtr<");
+    } else if (inProp->IsA<HAXE_SOFT_CLASS_PROPERTY>()) {
+      wrapper = HAXE_SOFT_CLASS_PTR;
+      uclass = Cast<HAXE_SOFT_CLASS_PROPERTY>(inProp)->MetaClass;
+    } else if (inProp->IsA<HAXE_SOFT_OBJECT_PROPERTY>()) {
+      wrapper = HAXE_SOFT_OBJECT_PTR;
+    } else {
+      LOG("Object property %s (class %s) not supported", *inProp->GetName(), *inProp->GetClass()->GetName());
+      return false;
+    }
+    auto descr = m_haxeTypes.getDescriptor(uclass);
+    if (descr == nullptr) {
+      LOG("(object pointer) TYPE NOT SUPPORTED: %s", *uclass->GetName());
+      return false;
+    }
+    return writeWithModifiers(wrapper + descr->haxeType.toString() + TEXT(">"), inProp, outType);
+  } else if (inProp->IsA<UInterfaceProperty>()) {
+    auto prop = Cast<UInterfaceProperty>(inProp);
+    auto descr = m_haxeTypes.getDescriptor(prop->InterfaceClass);
+    if (descr == nullptr) {
+      LOG("(tscriptinterface) TYPE NOT SUPPORTED: %s", *prop->InterfaceClass->GetName());
+      return false;
+    }
+    return writeWithModifiers(TEXT("unreal.TScriptInterface<") + descr->haxeType.toString() + TEXT(">"), inProp, outType);
   } else if (inProp->IsA<UNumericProperty>()) {
     auto numeric = Cast<UNumericProperty>(inProp);
     UEnum *uenum = numeric->GetIntPropertyEnum();
@@ -658,6 +2055,16 @@ bool FHaxeGenerator::upropType(UProperty* inProp, FString &outType) {
   } else if (inProp->IsA<UBoolProperty>()) {
     return writeBasicWithModifiers(TEXT("Bool"), inProp, outType);
     return true;
+  } else if (inProp->IsA<UDelegateProperty>() || inProp->IsA<UMulticastDelegateProperty>()) {
+    auto signature = inProp->IsA<UDelegateProperty>() ?
+      Cast<UDelegateProperty>(inProp)->SignatureFunction :
+      Cast<UMulticastDelegateProperty>(inProp)->SignatureFunction;
+    auto descr = m_haxeTypes.getDescriptor(signature);
+    if (descr == nullptr || !isDelegateSupported(descr)) {
+      LOG("(delegate) TYPE NOT SUPPORTED: %s", *inProp->GetName());
+      return false;
+    }
+    return writeWithModifiers(descr->haxeType.toString(), inProp, outType);
   } else if (inProp->IsA<UNameProperty>()) {
     return writeWithModifiers(TEXT("unreal.FName"), inProp, outType);
   } else if (inProp->IsA<UStrProperty>()) {
@@ -668,17 +2075,25 @@ bool FHaxeGenerator::upropType(UProperty* inProp, FString &outType) {
     if (!upropType(prop->Inner, inner))
       return false;
     return canBuildTArrayProp(inner, prop->Inner) && writeWithModifiers(TEXT("unreal.TArray<") + inner + TEXT(">"), inProp, outType);
+#if HAXE_HAS_MAP_PROPERTY
+  } else if (inProp->IsA<UMapProperty>()) {
+    auto prop = Cast<UMapProperty>(inProp);
+    FString key, value;
+    if (!upropType(prop->KeyProp, key) || !upropType(prop->ValueProp, value))
+      return false;
+    // same limitations as TArray
+    return canBuildTArrayProp(key, prop->KeyProp) && canBuildTArrayProp(value, prop->ValueProp) &&
+      writeWithModifiers(TEXT("unreal.TMap<") + key + TEXT(", ") + value + TEXT(">"), inProp, outType);
+#endif
+#if HAXE_HAS_SET_PROPERTY
+  } else if (inProp->IsA<USetProperty>()) {
+    auto prop = Cast<USetProperty>(inProp);
+    FString inner;
+    if (!upropType(prop->ElementProp, inner))
+      return false;
+    return canBuildTArrayProp(inner, prop->ElementProp) && writeWithModifiers(TEXT("unreal.TSet<") + inner + TEXT(">"), inProp, outType);
+#endif
   }
-  // uenum
-  // uinterface
-  // udelegate
-  //
-  // TLazyObjectPtr
-  // UAssetObjectPtr - TPersistentObjectPtr
-  // UInterfaceProperty
-  // UMapProperty (TMap)
-  // UDelegateProperty 
-  // UMulticastDelegateProperty 
 
   LOG("Property %s (class %s) not supported", *inProp->GetName(), *inProp->GetClass()->GetName());
   return false;
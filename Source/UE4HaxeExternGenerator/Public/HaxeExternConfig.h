@@ -0,0 +1,235 @@
+#pragma once
+#include <CoreUObject.h>
+#include "HaxeTypes.h"
+
+/**
+ * Per-target configuration of the extern generator. It's read from `Config/HaxeExternGenerator.ini` inside the UE4Haxe
+ * plugin directory. The entries of the `[HaxeExternGenerator]` section apply to all targets, and the ones
+ * on `[HaxeExternGenerator.<TargetName>]` are added to them when building `<TargetName>`. e.g.:
+ *
+ *   [HaxeExternGenerator]
+ *   TargetType=Editor
+ *   +ExcludeModules=Landscape
+ *   +ExcludePackages=unreal.editor
+ *
+ *   [HaxeExternGenerator.MyGameEditor]
+ *   +Roots=MyGame
+ *
+ * Generation itself is still only enabled when the `GENERATE_EXTERNS` environment variable is set
+ **/
+struct FHaxeExternConfig {
+  static const TCHAR *SectionName;
+
+  // either `Any`, `Editor` or `Game`
+  FString targetType;
+  // if not empty, only these targets will generate externs
+  TArray<FString> targets;
+  // if not empty, only the classes of these modules are exported. Unlike `excludeModules`, it doesn't filter the
+  // structs, enums and delegates that exported classes reference, so their externs are complete
+  TArray<FString> includeModules;
+  TArray<FString> excludeModules;
+  // if not empty, only the classes of modules whose Haxe package is (or is inside) one of these packages are exported.
+  // Like `includeModules`, it doesn't filter referenced types
+  TArray<FString> includePackages;
+  TArray<FString> excludePackages;
+  // @see `FHaxeTypes::getReachableTypes`
+  TArray<FString> roots;
+  bool pipeline;
+  // emit @:ulayout metadata and the `ulayout` static_assert headers. Only honored with `compiledReflection`
+  bool emitLayout;
+  // emit @:uframe/@:uparams call frame metadata on UFUNCTIONs. Only honored with `compiledReflection`
+  bool emitCallFrames;
+  // emit @:ubool metadata and protected bit-fields
+  bool emitBoolMasks;
+  // emit @:ubulkView/@:ubulkViewArg metadata on TArrays of plain old data
+  bool emitBulkViews;
+  // emit @:umapLayout/@:usetLayout metadata on TMap and TSet properties
+  bool emitContainerLayouts;
+  // emit @:upod, @:uzeroConstructor, @:unoDestructor, @:ucopyNative and @:uidenticalNative on structs.
+  // Only honored with `compiledReflection`
+  bool emitStructTraits;
+  // allow copying @:upod structs that are not exported, since they can be copied with memcpy. Needs `emitStructTraits`
+  bool copyPodStructs;
+  // write editor-only properties and the `unreal.editor` package to `Haxe/EditorExterns` instead of `Haxe/Externs`
+  bool splitEditorOnly;
+  // write tooltips to the `Haxe/Docs` index instead of doc comments on the externs
+  bool stripTooltips;
+  // write `umodules/AllModules.h`, with the headers of all modules
+  bool aggregateModules;
+  // a local or shared directory where the generated files are cached; see `FHaxeExternGenerator::getCacheKey`
+  FString cacheDir;
+  // emit @:upure, @:uthreadSafe and @:unative on UFUNCTIONs, and the list of thread-safe functions
+  bool emitFunctionTraits;
+  // scan the source headers for UFUNCTION parameters declared as const references
+  bool scanConstRefParams;
+  // `ClassName.FuncName.ParamName` (e.g. `AActor.SetActorTransform.NewTransform`) of parameters that should be
+  // treated as const references, for the cases the header scanner gets wrong
+  TArray<FString> constRefParams;
+  // generate enums as `@:enum abstract`s with their C++ integer values
+  bool enumAbstracts;
+  // mark classes that no exported class extends with @:uleaf. Only valid when every module is exported
+  bool inferLeafClasses;
+  // not read from the configuration: set when generating from the loaded reflection data of a compiled engine
+  // (`IHaxeExternGenerator::generateFrom`). UHT builds its types from the parsed headers, so it only knows their
+  // UPROPERTYs - sizes, offsets and the struct flags computed from the C++ type traits are only valid with this set
+  bool compiledReflection;
+
+  FHaxeExternConfig() :
+    targetType(TEXT("Any")),
+    pipeline(false),
+    emitLayout(false),
+    emitCallFrames(false),
+    emitBoolMasks(false),
+    emitBulkViews(false),
+    emitContainerLayouts(false),
+    emitStructTraits(false),
+    copyPodStructs(false),
+    emitFunctionTraits(false),
+    splitEditorOnly(false),
+    stripTooltips(false),
+    aggregateModules(false),
+    scanConstRefParams(false),
+    enumAbstracts(false),
+    inferLeafClasses(false),
+    compiledReflection(false)
+  {
+  }
+
+  void load(const FString &inPath, const FString &inTargetName) {
+    FConfigFile file;
+    if (!FPlatformFileManager::Get().GetPlatformFile().FileExists(*inPath)) {
+      LOG("No generator configuration found at %s", *inPath);
+      return;
+    }
+    file.Read(inPath);
+    loadSection(file.Find(SectionName));
+    loadSection(file.Find(FString(SectionName) + TEXT(".") + inTargetName));
+  }
+
+  bool supportsTarget(const FString &inTargetName) const {
+    if (targets.Num() > 0 && !targets.Contains(inTargetName)) {
+      return false;
+    }
+    auto isEditor = inTargetName.EndsWith(TEXT("Editor"));
+    if (targetType == TEXT("Editor")) {
+      return isEditor;
+    } else if (targetType == TEXT("Game")) {
+      return !isEditor;
+    }
+    return true;
+  }
+
+  bool shouldExportModule(const FString &inModuleName) const {
+    if (excludeModules.Contains(inModuleName)) {
+      return false;
+    }
+    if (includeModules.Num() > 0 && !includeModules.Contains(inModuleName)) {
+      return false;
+    }
+    if (includePackages.Num() == 0 && excludePackages.Num() == 0) {
+      return true;
+    }
+
+    auto pack = FindObject<UPackage>(nullptr, *(FString(TEXT("/Script/")) + inModuleName));
+    if (pack == nullptr) {
+      return includePackages.Num() == 0;
+    }
+    auto haxePack = getHaxePackageName(pack);
+    if (matchesPackage(excludePackages, haxePack)) {
+      return false;
+    }
+    return includePackages.Num() == 0 || matchesPackage(includePackages, haxePack);
+  }
+
+  /**
+   * all the options that change the generated files, so they can be part of the cache key
+   **/
+  FString describe() const {
+    FString ret;
+    ret += FString::Printf(TEXT("layout=%d callFrames=%d boolMasks=%d bulkViews=%d containerLayouts=%d structTraits=%d copyPodStructs=%d functionTraits=%d splitEditorOnly=%d stripTooltips=%d aggregateModules=%d enumAbstracts=%d scanConstRefParams=%d inferLeafClasses=%d compiledReflection=%d\n"),
+        emitLayout, emitCallFrames, emitBoolMasks, emitBulkViews, emitContainerLayouts, emitStructTraits, copyPodStructs, emitFunctionTraits, splitEditorOnly, stripTooltips, aggregateModules, enumAbstracts, scanConstRefParams,
+        inferLeafClasses, compiledReflection);
+    ret += TEXT("includeModules=") + FString::Join(includeModules, TEXT(",")) + TEXT("\n");
+    ret += TEXT("excludeModules=") + FString::Join(excludeModules, TEXT(",")) + TEXT("\n");
+    ret += TEXT("includePackages=") + FString::Join(includePackages, TEXT(",")) + TEXT("\n");
+    ret += TEXT("excludePackages=") + FString::Join(excludePackages, TEXT(",")) + TEXT("\n");
+    ret += TEXT("constRefParams=") + FString::Join(constRefParams, TEXT(",")) + TEXT("\n");
+    return ret;
+  }
+
+  // checks if some of the target's modules may not be exported
+  bool filtersModules() const {
+    return includeModules.Num() > 0 || excludeModules.Num() > 0 || includePackages.Num() > 0 || excludePackages.Num() > 0;
+  }
+
+  /**
+   * checks if types from `inPack` were explicitly excluded. Structs and enums that are referenced by exported classes
+   * but belong to an excluded package are never touched. `includeModules` and `includePackages` are not checked here,
+   * since they only select which modules' classes are exported
+   **/
+  bool isPackageExcluded(UPackage *inPack) const {
+    if (excludeModules.Num() == 0 && excludePackages.Num() == 0) {
+      return false;
+    }
+    auto moduleName = inPack->GetName().RightChop( sizeof("/Script") );
+    return excludeModules.Contains(moduleName) || matchesPackage(excludePackages, getHaxePackageName(inPack));
+  }
+
+private:
+  void loadSection(const FConfigSection *inSection) {
+    if (inSection == nullptr) {
+      return;
+    }
+    auto type = inSection->Find(TEXT("TargetType"));
+    if (type != nullptr) {
+      targetType = *type;
+    }
+    auto cache = inSection->Find(TEXT("CacheDir"));
+    if (cache != nullptr) {
+      cacheDir = *cache;
+    }
+    loadBool(inSection, TEXT("bPipeline"), pipeline);
+    loadBool(inSection, TEXT("bEmitLayout"), emitLayout);
+    loadBool(inSection, TEXT("bEmitCallFrames"), emitCallFrames);
+    loadBool(inSection, TEXT("bEmitBoolMasks"), emitBoolMasks);
+    loadBool(inSection, TEXT("bEmitBulkViews"), emitBulkViews);
+    loadBool(inSection, TEXT("bEmitContainerLayouts"), emitContainerLayouts);
+    loadBool(inSection, TEXT("bEmitStructTraits"), emitStructTraits);
+    loadBool(inSection, TEXT("bCopyPodStructs"), copyPodStructs);
+    loadBool(inSection, TEXT("bEmitFunctionTraits"), emitFunctionTraits);
+    loadBool(inSection, TEXT("bSplitEditorOnly"), splitEditorOnly);
+    loadBool(inSection, TEXT("bStripTooltips"), stripTooltips);
+    loadBool(inSection, TEXT("bAggregateModules"), aggregateModules);
+    loadBool(inSection, TEXT("bScanConstRefParams"), scanConstRefParams);
+    loadBool(inSection, TEXT("bEnumAbstracts"), enumAbstracts);
+    loadBool(inSection, TEXT("bInferLeafClasses"), inferLeafClasses);
+    inSection->MultiFind(TEXT("Targets"), targets);
+    inSection->MultiFind(TEXT("IncludeModules"), includeModules);
+    inSection->MultiFind(TEXT("ExcludeModules"), excludeModules);
+    inSection->MultiFind(TEXT("IncludePackages"), includePackages);
+    inSection->MultiFind(TEXT("ExcludePackages"), excludePackages);
+    inSection->MultiFind(TEXT("Roots"), roots);
+    inSection->MultiFind(TEXT("ConstRefParams"), constRefParams);
+  }
+
+  static void loadBool(const FConfigSection *inSection, const TCHAR *inKey, bool &outValue) {
+    auto value = inSection->Find(inKey);
+    if (value != nullptr) {
+      outValue = FCString::ToBool(**value);
+    }
+  }
+
+  static FString getHaxePackageName(UPackage *inPack) {
+    FString module;
+    return FString::Join(getHaxePackage(inPack, &module), TEXT("."));
+  }
+
+  static bool matchesPackage(const TArray<FString> &inPackages, const FString &inHaxePack) {
+    for (auto& pack : inPackages) {
+      if (inHaxePack == pack || inHaxePack.StartsWith(pack + TEXT("."))) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
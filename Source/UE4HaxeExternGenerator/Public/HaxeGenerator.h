@@ -1,6 +1,7 @@
 #pragma once
 #include <CoreUObject.h>
 #include "HaxeTypes.h"
+#include "HaxeExternConfig.h"
 
 struct Begin {
   const TCHAR *br;
@@ -42,6 +43,43 @@ private:
 
   bool m_hasContent = false;
 
+  void addSpan(const TCHAR *inText, int32 inLen) {
+    if (inLen > 0) {
+      this->m_buf.AppendChars(inText, inLen);
+      this->m_hasContent = true;
+    }
+  }
+
+  /**
+   * adds `inText`, adding a `newline` (and indentation) on every line break, in a single pass.
+   * If `inStripCommentEnd` is set, every `*` + `/` sequence is replaced by `*` so it can't close a doc comment
+   **/
+  void addLines(const TCHAR *inText, int32 inLen, bool inAddNewlineAfter, bool inStripCommentEnd) {
+    int32 start = 0;
+    bool lineHasText = false;
+    for (int32 i = 0; i < inLen; i++) {
+      auto c = inText[i];
+      if (c == TCHAR('\n')) {
+        this->addSpan(inText + start, i - start);
+        this->newline();
+        lineHasText = false;
+        start = i + 1;
+      } else if (inStripCommentEnd && c == TCHAR('*') && i + 1 < inLen && inText[i + 1] == TCHAR('/')) {
+        this->addSpan(inText + start, i + 1 - start);
+        lineHasText = true;
+        start = i + 2;
+        i++;
+      }
+    }
+    if (start < inLen) {
+      this->addSpan(inText + start, inLen - start);
+      lineHasText = true;
+    }
+    if (lineHasText && inAddNewlineAfter) {
+      this->newline();
+    }
+  }
+
 public:
   FHelperBuf() {
   }
@@ -52,7 +90,7 @@ public:
 
   FHelperBuf& newline() {
     this->m_hasContent = false;
-    return *this << "\n" << m_indent;
+    return *this << TEXT("\n") << m_indent;
   }
 
   FHelperBuf& begin(const TCHAR *inBr=TEXT("{")) {
@@ -62,7 +100,7 @@ public:
       return *this;
     }
 
-    return *this << inBr << "\n" << m_indent;
+    return *this << inBr << TEXT("\n") << m_indent;
   }
 
   FHelperBuf& end(const TCHAR *inBr=TEXT("}")) {
@@ -76,26 +114,45 @@ public:
     return *this;
   }
 
-  FHelperBuf& addEscaped(const FString& inText) {
-    this->m_buf += inText.ReplaceCharWithEscapedChar();
-    return *this;
+  // same escapes as `FString::ReplaceCharWithEscapedChar`
+  static const TCHAR *getEscape(TCHAR inChar) {
+    switch (inChar) {
+    case TCHAR('\\'):
+      return TEXT("\\\\");
+    case TCHAR('\n'):
+      return TEXT("\\n");
+    case TCHAR('\r'):
+      return TEXT("\\r");
+    case TCHAR('\t'):
+      return TEXT("\\t");
+    case TCHAR('\''):
+      return TEXT("\\'");
+    case TCHAR('"'):
+      return TEXT("\\\"");
+    default:
+      return nullptr;
+    }
   }
 
-  FHelperBuf& addNewlines(const FString& inText, bool inAddNewlineAfter=false) {
-    FString left;
-    FString right = inText;
-    static const FString nl = TEXT("\n");
-    while (right.Split(nl, &left, &right, ESearchCase::CaseSensitive, ESearchDir::FromStart)) {
-      *this << left;
-      this->newline();
-    }
-    if (!right.IsEmpty()) {
-      *this << right;
-      if (inAddNewlineAfter) {
-        this->newline();
+  FHelperBuf& addEscaped(const FString& inText) {
+    // copy the unescaped spans straight to the buffer, without creating a temporary escaped string
+    const TCHAR *text = *inText;
+    int32 len = inText.Len();
+    int32 start = 0;
+    for (int32 i = 0; i < len; i++) {
+      auto escaped = getEscape(text[i]);
+      if (escaped != nullptr) {
+        this->m_buf.AppendChars(text + start, i - start);
+        this->m_buf += escaped;
+        start = i + 1;
       }
     }
+    this->m_buf.AppendChars(text + start, len - start);
+    return *this;
+  }
 
+  FHelperBuf& addNewlines(const FString& inText, bool inAddNewlineAfter=false) {
+    this->addLines(*inText, inText.Len(), inAddNewlineAfter, false);
     return *this;
   }
 
@@ -104,7 +161,7 @@ public:
       this->newline();
     }
     this->begin(TEXT("/**"));
-    this->addNewlines(inText.Replace(TEXT("*/"), TEXT("*")), false);
+    this->addLines(*inText, inText.Len(), false, true);
     this->end(TEXT("**/"));
 
     return *this;
@@ -116,12 +173,25 @@ public:
     return *this;
   }
 
-  FHelperBuf& operator <<(const TCHAR *inText) {
+  /**
+   * string literals (e.g. `TEXT(" extends ")`) have their length known at compile-time, so they can be appended without
+   * a `strlen`. This is more specialized than the pointer overload below, so literals always end up here
+   **/
+  template<SIZE_T N>
+  FHelperBuf& operator <<(const TCHAR (&inText)[N]) {
+    this->m_buf.AppendChars(inText, N - 1);
+    this->m_hasContent = true;
+    return *this;
+  }
+
+  template<typename T>
+  typename TEnableIf<TAreTypesEqual<T, const TCHAR *>::Value || TAreTypesEqual<T, TCHAR *>::Value, FHelperBuf&>::Type operator <<(T inText) {
     this->m_buf += inText;
     this->m_hasContent = true;
     return *this;
   }
 
+  // narrow strings need to be converted on every call; prefer `TEXT()` literals
   FHelperBuf& operator <<(const char *inText) {
     this->m_buf += UTF8_TO_TCHAR(inText);
     this->m_hasContent = true;
@@ -134,6 +204,15 @@ public:
     return *this;
   }
 
+  // appends a block that was generated on its own buffer at the same indentation level
+  FHelperBuf& addBlock(const FHelperBuf &inBlock) {
+    if (!inBlock.m_buf.IsEmpty()) {
+      this->m_buf += inBlock.m_buf;
+      this->m_hasContent = inBlock.m_hasContent;
+    }
+    return *this;
+  }
+
   FHelperBuf& operator <<(const Begin inBegin) {
     return this->begin(inBegin.br);
   }
@@ -163,44 +242,183 @@ public:
   }
 };
 
+// a tooltip that was stripped from the externs
+struct FHaxeDocEntry {
+  // the Haxe package of the type
+  FString package;
+  // the full Haxe path of the type, followed by `.<member>` for fields and enum entries
+  FString key;
+  FString doc;
+};
+
+/**
+ * The fields of an interface are the same on every class that implements it, so they are only generated once per run
+ **/
+class FHaxeInterfaceFieldCache {
+public:
+  struct Entry {
+    FHelperBuf fields;
+    // the functions that were generated; if a class already has one of them, the block can't be reused
+    TSet<FString> names;
+  };
+
+  int32 hits = 0;
+  int32 misses = 0;
+
+  const Entry *find(UClass *inInterface) {
+    auto ret = m_entries.Find(inInterface);
+    if (ret != nullptr) {
+      hits++;
+    } else {
+      misses++;
+    }
+    return ret;
+  }
+
+  const Entry &add(UClass *inInterface, const FHelperBuf &inFields, const TSet<FString> &inNames) {
+    auto& entry = m_entries.Add(inInterface);
+    entry.fields = inFields;
+    entry.names = inNames;
+    return entry;
+  }
+
+private:
+  TMap<UClass *, Entry> m_entries;
+};
+
 class FHaxeGenerator {
 private:
   FHelperBuf m_buf;
   FHaxeTypes& m_haxeTypes;
   const FString& m_basePath;
+  const FHaxeExternConfig& m_config;
   bool m_hasStructs;
   TSet<FString> m_generatedFields;
+  FHaxeInterfaceFieldCache *m_interfaceCache = nullptr;
+
+  // the type being generated; layout metadata is only emitted for its own fields
+  UStruct *m_layoutOwner = nullptr;
+  FString m_layoutOwnerCpp;
+  bool m_layoutEditorOnly = false;
+  // C++ static_asserts that check the emitted layout metadata
+  FHelperBuf m_layoutChecks;
+  // editor-only properties, when `splitEditorOnly` is set
+  FHelperBuf m_editorOnlyBuf;
+  bool m_hasEditorOnly = false;
+  FString m_editorOnlyExtern;
+  // tooltips, when `stripTooltips` is set
+  TArray<FHaxeDocEntry> m_docs;
+  // full Haxe paths of the functions that were marked as @:uthreadSafe
+  TArray<FString> m_threadSafeFunctions;
 
   void collectSuperFields(UStruct *inSuper);
 public: 
-  FHaxeGenerator(FHaxeTypes& inTypes, const FString& inBasePath) : 
+  FHaxeGenerator(FHaxeTypes& inTypes, const FString& inBasePath, const FHaxeExternConfig& inConfig) : 
     m_buf(FHelperBuf()),
     m_haxeTypes(inTypes),
-    m_basePath(inBasePath)
+    m_basePath(inBasePath),
+    m_config(inConfig)
   {
   }
 
+  // interface fields will be reused from (and added to) `inCache`
+  void setInterfaceCache(FHaxeInterfaceFieldCache *inCache) {
+    m_interfaceCache = inCache;
+  }
+
   bool generateClass(const ClassDescriptor *inClass);
 
   bool generateStruct(const StructDescriptor *inStruct);
 
   bool generateEnum(const EnumDescriptor *inEnum);
 
+  bool generateDelegate(const DelegateDescriptor *inDelegate);
+
+  /**
+   * checks once per run if all arguments of `inDelegate` are supported. Unsupported delegates are not generated,
+   * so properties and arguments that use them can't be generated either
+   **/
+  bool isDelegateSupported(const DelegateDescriptor *inDelegate);
+
   FString toString() {
     return m_buf.toString();
   }
 
+  FString getLayoutChecks() {
+    return m_layoutChecks.toString();
+  }
+
+  // the `<Name>_EditorOnly` extern with the editor-only properties of the generated type, if there are any
+  FString getEditorOnlyExtern() {
+    return m_editorOnlyExtern;
+  }
+
+  const TArray<FHaxeDocEntry> &getDocs() {
+    return m_docs;
+  }
+
+  const TArray<FString> &getThreadSafeFunctions() {
+    return m_threadSafeFunctions;
+  }
+
   static FString getHeaderPath(UPackage *inPack, const FString& inPath);
 
+  // the C++ value of the enum entry at `inIndex`
+  static int64 getEnumValue(UEnum *inEnum, int32 inIndex);
+
 protected:
   bool writeWithModifiers(const FString &inName, UProperty *inProp, FString &outType);
 
   bool writeBasicWithModifiers(const FString &inName, UProperty *inProp, FString &outType);
 
+  // checks if a UFUNCTION parameter was declared as `const T&`
+  bool isConstRefParam(UProperty *inParam);
+
+  // unreal.FixedArray<T> for properties with ArrayDim > 1
+  bool writeFixedArray(const FString &inName, UProperty *inProp, FString &outType);
+
   // Gets the Haxe representation for a `UProperty` type. This is used both for uproperties and for ufunction arguments
   // Returns an empty string if the type is not supported
   bool upropType(UProperty* inProp, FString &outType);
 
   void generateFields(UStruct *inStruct, bool onlyProps);
+  // the fields of an interface that `inInterface` implements, from the interface cache if possible
+  void generateInterfaceFields(UClass *inInterface);
   void generateIncludeMetas(const NonClassDescriptor *inDesc);
+
+  // @:ulayout(size, alignment) for the type itself, if `emitLayout` is set
+  void generateTypeLayout(UStruct *inStruct, const FString &inCppName, int32 inSize);
+  // @:ulayout(offset, elementSize, alignment) for a property of the type being generated
+  void generatePropertyLayout(UProperty *inProp);
+  void endTypeLayout();
+
+  // @:uframe(parmsSize, returnValueOffset, isPod) and @:uparams([offset, size], ...) for a UFUNCTION
+  void generateCallFrame(UFunction *inFunc, FHelperBuf &outBuf);
+
+  // the doc comment of `inType` (or of its member `inMember`), or its documentation index entry if `stripTooltips` is set
+  void addDoc(const FHaxeTypeRef *inType, const FString &inMember, const FString &inDoc);
+
+  // swaps `m_buf` with the editor-only buffer
+  void swapEditorOnly();
+  void generateEditorOnlyExtern(const FHaxeTypeRef &inType);
+
+  // @:upure, @:uthreadSafe and @:unative for a UFUNCTION
+  void generateFunctionTraits(UFunction *inFunc, FHelperBuf &outBuf);
+
+  // adds `inFunc` to the thread-safe functions list; only called once the function is known to be generated
+  void addThreadSafeFunction(UFunction *inFunc);
+
+  // checks if `inFunc` or its class was declared with the BlueprintThreadSafe metadata
+  static bool isThreadSafe(UFunction *inFunc);
+
+  // @:ubool(isNative) for bool properties
+  void generateBoolMask(UBoolProperty *inProp);
+
+  // for `TArray`s of plain old data, gets the `elementSize, alignment` arguments of their bulk view metadata
+  // structs are only supported with compiled reflection data; see `FHaxeExternConfig::compiledReflection`
+  static bool getBulkView(UProperty *inProp, bool inCompiledReflection, FString &outArgs);
+
+  // @:umapLayout(keyOffset, valueOffset, stride, hashNextIdOffset, hashIndexOffset) for TMaps (until 4.21) and
+  // @:usetLayout(stride, hashNextIdOffset, hashIndexOffset) for TSets
+  static bool getContainerLayout(UProperty *inProp, FString &outMeta);
 };
@@ -0,0 +1,209 @@
+#pragma once
+#include <CoreUObject.h>
+
+/**
+ * A very small scanner for the UHT source headers. UHT doesn't tell us if a UFUNCTION parameter was declared as
+ * `const SomeType&` or as `SomeType`, so we look at the UFUNCTION declarations ourselves to find that out.
+ * It only needs to understand parameter lists, so anything else in the header is ignored
+ **/
+class FHaxeHeaderScanner {
+public:
+  /**
+   * adds `ClassName.FuncName.ParamName` to `outParams` for every parameter of a UFUNCTION declared in `inHeader`
+   * that is passed as a const reference. `ClassName` is the C++ name of the class that declares the function
+   * (e.g. `AActor`), since a header may declare many classes with functions of the same name
+   **/
+  static void findConstRefParams(const FString &inHeader, TSet<FString> &outParams) {
+    FString contents;
+    if (inHeader.IsEmpty() || !FFileHelper::LoadFileToString(contents, *inHeader)) {
+      return;
+    }
+    contents = stripComments(contents);
+    auto classes = findClassDefinitions(contents);
+
+    static const FString ufunction = TEXT("UFUNCTION");
+    int32 pos = 0;
+    while ((pos = contents.Find(ufunction, ESearchCase::CaseSensitive, ESearchDir::FromStart, pos)) >= 0) {
+      pos += ufunction.Len();
+      // skip the UFUNCTION(...) specifiers
+      int32 specEnd = findClosing(contents, contents.Find(TEXT("("), ESearchCase::CaseSensitive, ESearchDir::FromStart, pos));
+      if (specEnd < 0) {
+        break;
+      }
+      // the declaration's parameter list is the next parenthesis
+      int32 paramsStart = contents.Find(TEXT("("), ESearchCase::CaseSensitive, ESearchDir::FromStart, specEnd + 1);
+      int32 paramsEnd = findClosing(contents, paramsStart);
+      if (paramsEnd < 0) {
+        break;
+      }
+      auto name = lastIdentifier(contents.Mid(specEnd + 1, paramsStart - specEnd - 1));
+      auto className = getEnclosingClass(classes, pos);
+      if (!name.IsEmpty() && !className.IsEmpty()) {
+        for (auto& param : splitParams(contents.Mid(paramsStart + 1, paramsEnd - paramsStart - 1))) {
+          if (isConstRef(param)) {
+            outParams.Add(className + TEXT(".") + name + TEXT(".") + lastIdentifier(param));
+          }
+        }
+      }
+      pos = paramsEnd;
+    }
+  }
+
+private:
+  struct ClassDefinition {
+    int32 pos;
+    FString name;
+  };
+
+  // the identifier that ends right before `inPos`, skipping whitespace
+  static FString previousIdentifier(const FString &inText, int32 inPos) {
+    int32 end = inPos;
+    while (end > 0 && FChar::IsWhitespace(inText[end - 1])) end--;
+    int32 start = end;
+    while (start > 0 && isIdentChar(inText[start - 1])) start--;
+    return inText.Mid(start, end - start);
+  }
+
+  /**
+   * finds every `class [API] Name [final] :` or `class [API] Name {` in the header, in order.
+   * Forward declarations (`class Name;`), template parameters and scoped enums (`enum class`) are skipped
+   **/
+  static TArray<ClassDefinition> findClassDefinitions(const FString &inText) {
+    TArray<ClassDefinition> ret;
+    static const FString keyword = TEXT("class");
+    int32 pos = 0;
+    while ((pos = inText.Find(keyword, ESearchCase::CaseSensitive, ESearchDir::FromStart, pos)) >= 0) {
+      int32 start = pos;
+      pos += keyword.Len();
+      if ((start > 0 && isIdentChar(inText[start - 1])) || pos >= inText.Len() || isIdentChar(inText[pos])) {
+        continue;
+      }
+      if (previousIdentifier(inText, start) == TEXT("enum")) {
+        // `enum class EFoo : uint8 {` is not a class
+        continue;
+      }
+      TArray<FString> idents;
+      int32 i = pos;
+      for (; i < inText.Len(); i++) {
+        auto c = inText[i];
+        if (isIdentChar(c)) {
+          int32 identStart = i;
+          while (i < inText.Len() && isIdentChar(inText[i])) i++;
+          idents.Push(inText.Mid(identStart, i - identStart));
+          i--;
+        } else if (!FChar::IsWhitespace(c)) {
+          break;
+        }
+      }
+      if (i < inText.Len() && (inText[i] == TCHAR(':') || inText[i] == TCHAR('{')) && idents.Num() > 0) {
+        if (idents.Num() > 1 && idents.Last() == TEXT("final")) {
+          idents.Pop(false);
+        }
+        ClassDefinition def;
+        def.pos = start;
+        def.name = idents.Last();
+        ret.Push(def);
+      }
+    }
+    return ret;
+  }
+
+  // the name of the last class defined before `inPos`
+  static FString getEnclosingClass(const TArray<ClassDefinition> &inClasses, int32 inPos) {
+    FString ret;
+    for (auto& def : inClasses) {
+      if (def.pos > inPos) {
+        break;
+      }
+      ret = def.name;
+    }
+    return ret;
+  }
+
+  static FString stripComments(const FString &inText) {
+    FString ret;
+    ret.Reserve(inText.Len());
+    const TCHAR *text = *inText;
+    int32 len = inText.Len();
+    for (int32 i = 0; i < len; i++) {
+      if (text[i] == TCHAR('/') && i + 1 < len && text[i + 1] == TCHAR('/')) {
+        while (i < len && text[i] != TCHAR('\n')) i++;
+      } else if (text[i] == TCHAR('/') && i + 1 < len && text[i + 1] == TCHAR('*')) {
+        i += 2;
+        while (i + 1 < len && !(text[i] == TCHAR('*') && text[i + 1] == TCHAR('/'))) i++;
+        i++;
+      } else {
+        ret.AppendChar(text[i]);
+      }
+    }
+    return ret;
+  }
+
+  // returns the index of the parenthesis that closes the one at `inOpen`, or -1
+  static int32 findClosing(const FString &inText, int32 inOpen) {
+    if (inOpen < 0) {
+      return -1;
+    }
+    int32 depth = 0;
+    for (int32 i = inOpen; i < inText.Len(); i++) {
+      if (inText[i] == TCHAR('(')) {
+        depth++;
+      } else if (inText[i] == TCHAR(')') && --depth == 0) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // splits a parameter list on the commas that aren't inside templates or parenthesis, and removes default values
+  static TArray<FString> splitParams(const FString &inParams) {
+    TArray<FString> ret;
+    FString cur;
+    int32 depth = 0;
+    bool isDefault = false;
+    for (int32 i = 0; i < inParams.Len(); i++) {
+      auto c = inParams[i];
+      if (c == TCHAR('(') || c == TCHAR('<')) {
+        depth++;
+      } else if (c == TCHAR(')') || c == TCHAR('>')) {
+        depth--;
+      } else if (depth == 0 && c == TCHAR(',')) {
+        ret.Push(cur.Trim().TrimTrailing());
+        cur.Empty();
+        isDefault = false;
+        continue;
+      } else if (depth == 0 && c == TCHAR('=')) {
+        isDefault = true;
+      }
+      if (!isDefault) {
+        cur.AppendChar(c);
+      }
+    }
+    cur = cur.Trim().TrimTrailing();
+    if (!cur.IsEmpty()) {
+      ret.Push(cur);
+    }
+    return ret;
+  }
+
+  static bool isConstRef(const FString &inParam) {
+    auto param = inParam;
+    if (param.StartsWith(TEXT("UPARAM"))) {
+      // UPARAM(ref) is already known by UHT, but UPARAM(DisplayName=...) may come before `const`
+      param = param.Mid(findClosing(param, param.Find(TEXT("("))) + 1).Trim();
+    }
+    return param.StartsWith(TEXT("const ")) && param.Contains(TEXT("&")) && !param.Contains(TEXT("&&")) && !param.Contains(TEXT("*"));
+  }
+
+  static FString lastIdentifier(const FString &inText) {
+    int32 end = inText.Len();
+    while (end > 0 && !isIdentChar(inText[end - 1])) end--;
+    int32 start = end;
+    while (start > 0 && isIdentChar(inText[start - 1])) start--;
+    return inText.Mid(start, end - start);
+  }
+
+  static bool isIdentChar(TCHAR inChar) {
+    return FChar::IsAlnum(inChar) || inChar == TCHAR('_');
+  }
+};
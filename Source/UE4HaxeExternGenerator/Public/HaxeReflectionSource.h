@@ -0,0 +1,103 @@
+#pragma once
+#include <CoreUObject.h>
+#include "HaxeTypes.h"
+
+/**
+ * Where the classes that are touched by the generator come from. When running inside UHT, classes are fed to the generator
+ * by `ExportClass`. Other sources allow the same touch and generate phases to run outside UHT - e.g. from a commandlet
+ * or from an automation test, where the reflection data is already loaded - so generation can be profiled on its own.
+ * This only abstracts which classes are generated: everything else is read from the classes' UObject reflection data
+ **/
+class IHaxeReflectionSource {
+public:
+  virtual ~IHaxeReflectionSource() {}
+
+  // calls `inVisit` with every class, its source header and its module name, in the order they should be touched
+  virtual void forEachClass(TFunctionRef<void (UClass *inClass, const FString &inHeader, const FString &inModule)> inVisit) = 0;
+};
+
+/**
+ * An in-memory list of classes. The UHT backend records every class that UHT exports into it, so the session can be
+ * saved as a manifest and replayed later by `FHaxeManifestSource`
+ **/
+class FHaxeRecordedSource : public IHaxeReflectionSource {
+private:
+  struct Entry {
+    UClass *uclass;
+    FString header;
+    FString module;
+  };
+  TArray<Entry> m_entries;
+  TSet<UClass *> m_classes;
+
+public:
+  // UHT may export the same class more than once, so only its first export is kept
+  void addClass(UClass *inClass, const FString &inHeader, const FString &inModule) {
+    if (m_classes.Contains(inClass)) {
+      return;
+    }
+    m_classes.Add(inClass);
+    Entry entry;
+    entry.uclass = inClass;
+    entry.header = inHeader;
+    entry.module = inModule;
+    m_entries.Push(entry);
+  }
+
+  int32 num() const {
+    return m_entries.Num();
+  }
+
+  virtual void forEachClass(TFunctionRef<void (UClass *inClass, const FString &inHeader, const FString &inModule)> inVisit) override {
+    for (auto& entry : m_entries) {
+      inVisit(entry.uclass, entry.header, entry.module);
+    }
+  }
+
+  /**
+   * writes one `<module>\t<class path>\t<header>` line per recorded class
+   **/
+  bool saveManifest(const FString &inPath) const {
+    FString contents;
+    for (auto& entry : m_entries) {
+      contents += entry.module + TEXT("\t") + entry.uclass->GetPathName() + TEXT("\t") + entry.header + TEXT("\n");
+    }
+    return FFileHelper::SaveStringToFile(contents, *inPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+  }
+};
+
+/**
+ * Replays a manifest written by `FHaxeRecordedSource::saveManifest`. The classes are looked up by their path names,
+ * so they must already be loaded
+ **/
+class FHaxeManifestSource : public IHaxeReflectionSource {
+private:
+  TArray<FString> m_lines;
+
+public:
+  bool load(const FString &inPath) {
+    FString contents;
+    if (!FFileHelper::LoadFileToString(contents, *inPath)) {
+      return false;
+    }
+    contents.ParseIntoArrayLines(m_lines);
+    return true;
+  }
+
+  virtual void forEachClass(TFunctionRef<void (UClass *inClass, const FString &inHeader, const FString &inModule)> inVisit) override {
+    for (auto& line : m_lines) {
+      TArray<FString> parts;
+      // the header may be empty
+      line.ParseIntoArray(parts, TEXT("\t"), false);
+      if (parts.Num() < 2) {
+        continue;
+      }
+      auto uclass = FindObject<UClass>(nullptr, *parts[1]);
+      if (uclass == nullptr) {
+        UE_LOG(LogHaxeExtern, Warning, TEXT("Class %s from the manifest was not found"), *parts[1]);
+        continue;
+      }
+      inVisit(uclass, parts.Num() > 2 ? parts[2] : FString(), parts[0]);
+    }
+  }
+};
@@ -0,0 +1,159 @@
+#pragma once
+#include <CoreUObject.h>
+
+/**
+ * A run-wide pool for the strings that are repeated across many descriptors - header paths, module names and
+ * Haxe packages. Each unique string is stored only once, and descriptors keep a compact `FHaxeStr` handle to it.
+ * Strings are never removed, so references to them stay valid until the generator is unloaded
+ **/
+class FHaxeStringPool {
+private:
+  enum {
+    ChunkSize = 1024,
+    MaxChunks = 1024
+  };
+
+  // strings are stored in fixed-size chunks that are never moved or freed, and the chunk table itself never grows.
+  // So once a string was added and `m_numStrings` was published, it can be read without holding `m_lock`
+  FString *m_chunks[MaxChunks];
+  FThreadSafeCounter m_numStrings;
+  TMultiMap<uint32, int32> m_byHash;
+  // indirect, so growing the array doesn't move the packages that `FHaxeTypeRef`s reference
+  TIndirectArray<TArray<FString>> m_packs;
+  TMap<FString, int32> m_packsByPath;
+  // guards adding strings and packages; the pool is shared by every generator in the process
+  FCriticalSection m_lock;
+
+  int32 m_lookups = 0;
+  int64 m_savedBytes = 0;
+
+  FHaxeStringPool() {
+    FMemory::Memzero(m_chunks, sizeof(m_chunks));
+    // index 0 is always the empty string
+    addString(FString());
+    m_packs.Add(new TArray<FString>());
+  }
+
+  // must be called with `m_lock` held
+  int32 addString(const FString &inStr) {
+    auto index = m_numStrings.GetValue();
+    checkf(index < ChunkSize * MaxChunks, TEXT("The string pool is full"));
+    auto& chunk = m_chunks[index / ChunkSize];
+    if (chunk == nullptr) {
+      chunk = new FString[ChunkSize];
+    }
+    chunk[index % ChunkSize] = inStr;
+    // publishes the string to readers on other threads
+    m_numStrings.Increment();
+    return index;
+  }
+
+public:
+  static FHaxeStringPool &get() {
+    static FHaxeStringPool pool;
+    return pool;
+  }
+
+  int32 intern(const FString &inStr) {
+    if (inStr.IsEmpty()) {
+      return 0;
+    }
+    FScopeLock lock(&m_lock);
+    m_lookups++;
+    auto hash = GetTypeHash(inStr);
+    TArray<int32> candidates;
+    m_byHash.MultiFind(hash, candidates);
+    for (auto index : candidates) {
+      // the FString hash is case-insensitive, but header paths and packages are not
+      if (getString(index).Equals(inStr, ESearchCase::CaseSensitive)) {
+        m_savedBytes += inStr.GetAllocatedSize();
+        return index;
+      }
+    }
+    auto index = addString(inStr);
+    m_byHash.Add(hash, index);
+    return index;
+  }
+
+  // lock-free: `inIndex` comes from `intern`, so its string was already published
+  const FString &getString(int32 inIndex) const {
+    checkSlow(inIndex >= 0 && inIndex < m_numStrings.GetValue());
+    return m_chunks[inIndex / ChunkSize][inIndex % ChunkSize];
+  }
+
+  // the shared copy of a Haxe package
+  const TArray<FString> &internPack(const TArray<FString> &inPack) {
+    if (inPack.Num() == 0) {
+      return m_packs[0];
+    }
+    FScopeLock lock(&m_lock);
+    auto path = FString::Join(inPack, TEXT("."));
+    auto index = m_packsByPath.Find(path);
+    if (index != nullptr) {
+      m_savedBytes += inPack.GetAllocatedSize() + path.GetAllocatedSize();
+      return m_packs[*index];
+    }
+    auto added = m_packs.Add(new TArray<FString>(inPack));
+    m_packsByPath.Add(path, added);
+    return m_packs[added];
+  }
+
+  /**
+   * adds the number of unique strings and an estimate of the bytes used and saved by the pool to `outReport`
+   **/
+  void addMemoryReport(FString &outReport) {
+    FScopeLock lock(&m_lock);
+    auto numStrings = m_numStrings.GetValue();
+    SIZE_T used = sizeof(m_chunks) + m_byHash.GetAllocatedSize() + m_packs.GetAllocatedSize() + m_packsByPath.GetAllocatedSize();
+    for (int32 i = 0; i < MaxChunks && m_chunks[i] != nullptr; i++) {
+      used += sizeof(FString) * ChunkSize;
+    }
+    for (int32 i = 0; i < numStrings; i++) {
+      used += getString(i).GetAllocatedSize();
+    }
+    for (int32 i = 0; i < m_packs.Num(); i++) {
+      used += sizeof(TArray<FString>) + m_packs[i].GetAllocatedSize();
+      for (auto& part : m_packs[i]) {
+        used += part.GetAllocatedSize();
+      }
+    }
+    outReport += FString::Printf(TEXT("string pool: %d strings and %d packages (%d lookups), %lld bytes used, %lld bytes saved\n"),
+        numStrings, m_packs.Num(), m_lookups, (long long int) used, (long long int) m_savedBytes);
+  }
+};
+
+/**
+ * A handle to a string in the `FHaxeStringPool`. It converts implicitly to `const FString&`, so it can be used
+ * almost anywhere an FString is expected
+ **/
+struct FHaxeStr {
+  int32 index;
+
+  FHaxeStr() : index(0)
+  {
+  }
+
+  FHaxeStr(const FString &inStr) : index(FHaxeStringPool::get().intern(inStr))
+  {
+  }
+
+  const FString &operator *() const {
+    return FHaxeStringPool::get().getString(index);
+  }
+
+  operator const FString&() const {
+    return **this;
+  }
+
+  bool IsEmpty() const {
+    return index == 0;
+  }
+
+  bool operator ==(const FHaxeStr &inOther) const {
+    return index == inOther.index;
+  }
+
+  friend uint32 GetTypeHash(const FHaxeStr &inStr) {
+    return ::GetTypeHash(inStr.index);
+  }
+};
@@ -1,9 +1,32 @@
 #pragma once
 #include <CoreUObject.h>
+#include <Runtime/Launch/Resources/Version.h>
+#include "HaxeHeaderScanner.h"
+#include "HaxeStringPool.h"
 DECLARE_LOG_CATEGORY_EXTERN(LogHaxeExtern, Log, All);
 
 #define LOG(str,...) UE_LOG(LogHaxeExtern, Log, TEXT(str), __VA_ARGS__)
 
+// TMap and TSet UPROPERTYs were only introduced in later engine versions
+#define HAXE_HAS_MAP_PROPERTY (ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 12)
+#define HAXE_HAS_SET_PROPERTY (ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 15)
+// FScriptMapLayout stores the key offset until 4.21; later versions always place the key at offset 0 and dropped the field
+#define HAXE_HAS_MAP_KEY_OFFSET (HAXE_HAS_MAP_PROPERTY && ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION < 22)
+
+// UAssetObjectProperty/UAssetClassProperty (TAssetPtr/TAssetSubclassOf) were renamed to
+// USoftObjectProperty/USoftClassProperty (TSoftObjectPtr/TSoftClassPtr) on 4.18
+#if ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 18
+  #define HAXE_SOFT_OBJECT_PROPERTY USoftObjectProperty
+  #define HAXE_SOFT_CLASS_PROPERTY USoftClassProperty
+  #define HAXE_SOFT_OBJECT_PTR TEXT("unreal.TSoftObjectPtr<")
+  #define HAXE_SOFT_CLASS_PTR TEXT("unreal.TSoftClassPtr<")
+#else
+  #define HAXE_SOFT_OBJECT_PROPERTY UAssetObjectProperty
+  #define HAXE_SOFT_CLASS_PROPERTY UAssetClassProperty
+  #define HAXE_SOFT_OBJECT_PTR TEXT("unreal.TAssetPtr<")
+  #define HAXE_SOFT_CLASS_PTR TEXT("unreal.TAssetSubclassOf<")
+#endif
+
 enum class ETypeKind {
   KNone,
   KUObject,
@@ -14,13 +37,14 @@ enum class ETypeKind {
 };
 
 struct FHaxeTypeRef {
-  const TArray<FString> pack;
+  // `pack` and `module` are shared by all types of the same module (see `FHaxeStringPool`)
+  const TArray<FString> &pack;
   const FString name;
   const ETypeKind kind;
-  const FString module;
+  const FHaxeStr module;
 
   FHaxeTypeRef(const TArray<FString> inPack, const FString inName, ETypeKind inKind, const FString inModule) :
-    pack(inPack),
+    pack(FHaxeStringPool::get().internPack(inPack)),
     name(inName),
     kind(inKind),
     module(inModule)
@@ -28,9 +52,10 @@ struct FHaxeTypeRef {
   }
 
   FHaxeTypeRef(const FString inName, ETypeKind inKind) :
+    pack(FHaxeStringPool::get().internPack(TArray<FString>())),
     name(inName),
     kind(inKind),
-    module(FString())
+    module()
   {
   }
 
@@ -70,8 +95,10 @@ static const TArray<FString> getHaxePackage(UPackage *inPack, FString * outModul
 
 struct ClassDescriptor {
   UClass *uclass;
-  FString header;
+  FHaxeStr header;
   const FHaxeTypeRef haxeType;
+  // `FuncName.ParamName` of the UFUNCTION parameters that were declared as const references
+  TSet<FString> constRefParams;
 
   ClassDescriptor(UClass *inUClass, const FString &inHeader) :
     uclass(inUClass),
@@ -101,10 +128,12 @@ class ModuleDescriptor {
 private:
   TArray<ClassDescriptor *> m_classes;
   UPackage *m_module;
+  // set once UHT has moved on to the next module; no more classes will be touched after that
+  bool m_complete = false;
 
 public:
-  TSet<FString> headers;
-  TArray<FString> headerOrder;
+  // the headers of the touched classes; unordered, so users that need a stable order must sort them
+  TSet<FHaxeStr> headers;
   FString moduleName;
 
   ModuleDescriptor(UPackage *inPackage) :
@@ -114,10 +143,7 @@ public:
 
   void touch(ClassDescriptor *inClass, FString inModuleName) {
     this->m_classes.Push(inClass);
-    if (!this->headers.Contains(inClass->header)) {
-      this->headers.Add(inClass->header);
-      this->headerOrder.Push(inClass->header);
-    }
+    this->headers.Add(inClass->header);
 
     if (this->moduleName.IsEmpty())
       this->moduleName = inModuleName;
@@ -126,6 +152,18 @@ public:
   UPackage *getPackage() const {
     return m_module;
   }
+
+  const TArray<ClassDescriptor *>& getClasses() const {
+    return m_classes;
+  }
+
+  void markComplete() {
+    m_complete = true;
+  }
+
+  bool isComplete() const {
+    return m_complete;
+  }
 };
 
 struct NonClassDescriptor {
@@ -156,11 +194,11 @@ struct NonClassDescriptor {
     }
 
     for (auto m : sameModuleRefs) {
-      ret.Push(m->header);
+      ret.Push(*m->header);
       return ret;
     }
     for (auto m : otherModuleRefs) {
-      ret.Push(m->header);
+      ret.Push(*m->header);
       return ret;
     }
 
@@ -171,7 +209,7 @@ struct NonClassDescriptor {
     }
 
     for (auto header : module->headers) {
-      ret.Push(header);
+      ret.Push(*header);
     }
     ret.Sort();
 
@@ -247,15 +285,60 @@ private:
   }
 };
 
-// struct DelegateDescriptor : public NonClassDescriptor {
-//   UDelegate *udelegate;
-// };
+struct DelegateDescriptor : public NonClassDescriptor {
+  UFunction *signature;
+
+  DelegateDescriptor(UFunction *inSignature, ModuleDescriptor *inModule) :
+    NonClassDescriptor(getHaxeType(inSignature), inModule),
+    signature(inSignature)
+  {
+  }
+
+  bool isMulticast() const {
+    return signature->HasAnyFunctionFlags(FUNC_MulticastDelegate);
+  }
+
+  // the C++ type name of a delegate; its signature is named `<Name>__DelegateSignature`.
+  // Delegates declared inside a class are nested C++ types, e.g. `UWidget::FGetText`
+  static FString getCppName(UFunction *inSignature) {
+    static const FString suffix = TEXT("__DelegateSignature");
+    auto name = inSignature->GetName();
+    if (name.EndsWith(suffix)) {
+      name = name.LeftChop(suffix.Len());
+    }
+    auto outer = Cast<UClass>(inSignature->GetOuter());
+    if (outer != nullptr) {
+      return outer->GetPrefixCPP() + outer->GetName() + TEXT("::F") + name;
+    }
+    return TEXT("F") + name;
+  }
+
+  bool isNested() const {
+    return signature->GetOuter()->IsA<UClass>();
+  }
+
+private:
+  static FHaxeTypeRef getHaxeType(UFunction *inSignature) {
+    auto pack = inSignature->GetOutermost();
+    FString module;
+    // Haxe has no nested types, so these are qualified by their class instead (e.g. `UWidget_FGetText`)
+    return FHaxeTypeRef(
+      getHaxePackage(pack, &module),
+      getCppName(inSignature).Replace(TEXT("::"), TEXT("_")),
+      ETypeKind::KUDelegate,
+      module);
+  }
+};
 
 class FHaxeTypes {
 private:
   TMap<FString, ClassDescriptor *> m_classes;
   TMap<FString, EnumDescriptor *> m_enums;
   TMap<FString, StructDescriptor *> m_structs;
+  // keyed by path name, since signatures declared inside different classes can have the same name
+  TMap<FString, DelegateDescriptor *> m_delegates;
+  // whether each delegate can be generated; see `FHaxeGenerator::isDelegateSupported`
+  TMap<const DelegateDescriptor *, bool> m_delegateSupport;
 
   TMap<UPackage *, ModuleDescriptor *> m_upackageToModule;
 
@@ -263,11 +346,75 @@ private:
 
   FString m_pluginPath;
 
-  void deleteFileIfExists(FHaxeTypeRef haxeType) {
-    auto outPath = this->m_pluginPath / TEXT("Haxe/Externs") / FString::Join(haxeType.pack, TEXT("/")) / haxeType.name + TEXT(".hx");
-    if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*outPath)) {
-      LOG("Deleting previously generated file %s", *outPath);
-      FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*outPath);
+  // types from packages for which this returns true are never touched
+  TFunction<bool (UPackage *)> m_isExcluded;
+
+  // the results of `FHaxeHeaderScanner::findConstRefParams` for each header, so headers with many classes are only scanned once
+  TMap<FString, TSet<FString>> m_headerConstRefParams;
+  bool m_scanConstRefParams = false;
+
+  const TSet<FString> &getHeaderConstRefParams(const FString &inHeader) {
+    auto cached = m_headerConstRefParams.Find(inHeader);
+    if (cached != nullptr) {
+      return *cached;
+    }
+    auto& ret = m_headerConstRefParams.Add(inHeader);
+    FHaxeHeaderScanner::findConstRefParams(inHeader, ret);
+    return ret;
+  }
+
+  // every class that is extended by a touched class; see `computeHierarchy`
+  TSet<UClass *> m_superClasses;
+  bool m_hasHierarchy = false;
+
+  bool isExcluded(UPackage *inPackage) {
+    return m_isExcluded && m_isExcluded(inPackage);
+  }
+
+  static bool matchesRoot(const FHaxeTypeRef &inType, UField *inField, const TArray<FString> &inRoots) {
+    auto pack = FString::Join(inType.pack, TEXT("."));
+    for (auto& root : inRoots) {
+      if (root == *inType.module || root == pack || root == inType.name || root == inType.toString() || root == inField->GetName()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void addPropertyTypes(UProperty *inProp, TArray<UField *> &outTypes) {
+    // see `touchProperty` for all the property types that may reference another type
+    if (inProp->IsA<UStructProperty>()) {
+      outTypes.Push(Cast<UStructProperty>(inProp)->Struct);
+    } else if (inProp->IsA<UObjectPropertyBase>()) {
+      // also includes weak, lazy and soft pointers
+      outTypes.Push(Cast<UObjectPropertyBase>(inProp)->PropertyClass);
+      if (inProp->IsA<UClassProperty>()) {
+        outTypes.Push(Cast<UClassProperty>(inProp)->MetaClass);
+      } else if (inProp->IsA<HAXE_SOFT_CLASS_PROPERTY>()) {
+        outTypes.Push(Cast<HAXE_SOFT_CLASS_PROPERTY>(inProp)->MetaClass);
+      }
+    } else if (inProp->IsA<UInterfaceProperty>()) {
+      outTypes.Push(Cast<UInterfaceProperty>(inProp)->InterfaceClass);
+    } else if (inProp->IsA<UNumericProperty>()) {
+      UEnum *uenum = Cast<UNumericProperty>(inProp)->GetIntPropertyEnum();
+      if (nullptr != uenum) {
+        outTypes.Push(uenum);
+      }
+    } else if (inProp->IsA<UDelegateProperty>()) {
+      outTypes.Push(Cast<UDelegateProperty>(inProp)->SignatureFunction);
+    } else if (inProp->IsA<UMulticastDelegateProperty>()) {
+      outTypes.Push(Cast<UMulticastDelegateProperty>(inProp)->SignatureFunction);
+    } else if (inProp->IsA<UArrayProperty>()) {
+      addPropertyTypes(Cast<UArrayProperty>(inProp)->Inner, outTypes);
+#if HAXE_HAS_MAP_PROPERTY
+    } else if (inProp->IsA<UMapProperty>()) {
+      addPropertyTypes(Cast<UMapProperty>(inProp)->KeyProp, outTypes);
+      addPropertyTypes(Cast<UMapProperty>(inProp)->ValueProp, outTypes);
+#endif
+#if HAXE_HAS_SET_PROPERTY
+    } else if (inProp->IsA<USetProperty>()) {
+      addPropertyTypes(Cast<USetProperty>(inProp)->ElementProp, outTypes);
+#endif
     }
   }
 
@@ -278,10 +425,45 @@ public:
 
   FHaxeTypes() {}
 
+  // the descriptors are owned by this, so copying would free them twice
+  FHaxeTypes(const FHaxeTypes&) = delete;
+  FHaxeTypes& operator=(const FHaxeTypes&) = delete;
+
+  /**
+   * frees every descriptor and forgets all state, so the generator can run again from the same instance
+   **/
+  void reset(const FString &inPluginPath) {
+    freeDescriptors();
+    m_classes.Empty();
+    m_enums.Empty();
+    m_structs.Empty();
+    m_delegates.Empty();
+    m_delegateSupport.Empty();
+    m_upackageToModule.Empty();
+    m_pluginPath = inPluginPath;
+    m_isExcluded = nullptr;
+    m_headerConstRefParams.Empty();
+    m_scanConstRefParams = false;
+    m_superClasses.Empty();
+    m_hasHierarchy = false;
+  }
+
+  void setExcludedFilter(TFunction<bool (UPackage *)> inIsExcluded) {
+    m_isExcluded = inIsExcluded;
+  }
+
+  // look for const reference UFUNCTION parameters in the source headers
+  void setScanConstRefParams(bool inScan) {
+    m_scanConstRefParams = inScan;
+  }
+
   void touchClass(UClass *inClass, const FString &inHeader, const FString &inModule) {
     if (m_classes.Contains(inClass->GetName())) {
       return; // we've already touched this type; probably it's UObject which gets added every time (!)
     }
+    if (isExcluded(inClass->GetOuterUPackage())) {
+      return;
+    }
     FString header;
     if (inModule == TEXT("UMG")) {
       LOG("Module UMG %s", *inModule);
@@ -291,6 +473,15 @@ public:
       header = inHeader;
     }
     ClassDescriptor *cls = new ClassDescriptor(inClass, header);
+    if (m_scanConstRefParams) {
+      // UHT can't tell `const T&` from `T` parameters, so look at the declarations
+      auto prefix = cls->haxeType.name + TEXT(".");
+      for (auto& param : getHeaderConstRefParams(inHeader)) {
+        if (param.StartsWith(prefix, ESearchCase::CaseSensitive)) {
+          cls->constRefParams.Add(param.RightChop(prefix.Len()));
+        }
+      }
+    }
     m_classes.Add(inClass->GetName(), cls);
     LOG("Class name %s", *cls->haxeType.toString());
     auto module = getModule(inClass->GetOuterUPackage());
@@ -306,6 +497,11 @@ public:
     TFieldIterator<UFunction> funcs(inClass, EFieldIteratorFlags::ExcludeSuper);
     for (; funcs; ++funcs) {
       auto func = *funcs;
+      if (func->HasAnyFunctionFlags(FUNC_Delegate)) {
+        // delegate signatures declared inside the class
+        touchDelegate(func, cls);
+        continue;
+      }
       for (TFieldIterator<UProperty> args(func); args; ++args) {
         auto arg = *args;
         // nullptr because the type can be forward declared here
@@ -314,6 +510,161 @@ public:
     }
   }
 
+  /**
+   * marks every module that was touched under the UHT module name `inModuleName` as complete.
+   * Returns the modules that were newly completed
+   **/
+  TArray<ModuleDescriptor *> completeModule(const FString &inModuleName) {
+    TArray<ModuleDescriptor *> ret;
+    for (auto& elem : m_upackageToModule) {
+      auto module = elem.Value;
+      if (!module->isComplete() && module->moduleName == inModuleName) {
+        module->markComplete();
+        ret.Push(module);
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * checks if all classes that `inClass` references (supers, interfaces and property types) are either already
+   * touched, or belong to a module that is complete - which means they will never be touched.
+   * If that's the case, its extern can be generated before `FinishExport` with the same result
+   **/
+  bool isClassReady(const ClassDescriptor *inClass) {
+    auto uclass = inClass->uclass;
+    for (auto super = uclass->GetSuperClass(); super != nullptr; super = super->GetSuperClass()) {
+      if (!isClassRefReady(super)) {
+        return false;
+      }
+    }
+    for (auto& impl : uclass->Interfaces) {
+      if (!isClassRefReady(impl.Class)) {
+        return false;
+      }
+    }
+
+    for (TFieldIterator<UProperty> props(uclass, EFieldIteratorFlags::ExcludeSuper); props; ++props) {
+      if (!isPropertyReady(*props)) {
+        return false;
+      }
+    }
+    for (TFieldIterator<UFunction> funcs(uclass, EFieldIteratorFlags::ExcludeSuper); funcs; ++funcs) {
+      for (TFieldIterator<UProperty> args(*funcs); args; ++args) {
+        if (!isPropertyReady(*args)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * finds all classes that are extended by another touched class. This is a whole-program pass, so it must only be called
+   * once every module was touched - before that, a class with no known subclasses may still be extended
+   **/
+  int32 computeHierarchy() {
+    m_superClasses.Empty();
+    for (auto& elem : m_classes) {
+      for (auto super = elem.Value->uclass->GetSuperClass(); super != nullptr && !m_superClasses.Contains(super); super = super->GetSuperClass()) {
+        m_superClasses.Add(super);
+      }
+    }
+    m_hasHierarchy = true;
+
+    int32 leaves = 0;
+    for (auto& elem : m_classes) {
+      if (isLeafClass(elem.Value->uclass)) {
+        leaves++;
+      }
+    }
+    return leaves;
+  }
+
+  /**
+   * checks if no touched class extends `inClass`. Always false until `computeHierarchy` is called
+   **/
+  bool isLeafClass(UClass *inClass) {
+    return m_hasHierarchy && !inClass->HasAnyClassFlags(CLASS_Interface) && !m_superClasses.Contains(inClass);
+  }
+
+  /**
+   * deletes the extern of a pruned type from every directory it may have been written to by previous runs
+   **/
+  void deleteGeneratedFiles(const FHaxeTypeRef &haxeType) {
+    deleteFileIfExists(haxeType);
+    deleteFileIfExists(haxeType, TEXT("Haxe/EditorExterns"));
+    deleteFileIfExists(haxeType, TEXT("Haxe/EditorExterns"), TEXT("_EditorOnly"));
+  }
+
+  void deleteFileIfExists(const FHaxeTypeRef &haxeType, const TCHAR *inRoot = TEXT("Haxe/Externs"), const TCHAR *inSuffix = TEXT("")) {
+    auto outPath = this->m_pluginPath / inRoot / FString::Join(haxeType.pack, TEXT("/")) / haxeType.name + inSuffix + TEXT(".hx");
+    if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*outPath)) {
+      LOG("Deleting previously generated file %s", *outPath);
+      FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*outPath);
+    }
+  }
+
+  /**
+   * walks the type graph starting at every type that matches `inRoots` - which can be either a module name,
+   * a Haxe package or a type name - and returns all types that are reachable from them through supers,
+   * interfaces, property types and function argument types
+   **/
+  TSet<UField *> getReachableTypes(const TArray<FString> &inRoots) {
+    TSet<UField *> ret;
+    TArray<UField *> pending;
+    for (auto& elem : m_classes) {
+      if (matchesRoot(elem.Value->haxeType, elem.Value->uclass, inRoots)) {
+        pending.Push(elem.Value->uclass);
+      }
+    }
+    for (auto& elem : m_structs) {
+      if (matchesRoot(elem.Value->haxeType, elem.Value->ustruct, inRoots)) {
+        pending.Push(elem.Value->ustruct);
+      }
+    }
+    for (auto& elem : m_enums) {
+      if (matchesRoot(elem.Value->haxeType, elem.Value->uenum, inRoots)) {
+        pending.Push(elem.Value->uenum);
+      }
+    }
+    for (auto& elem : m_delegates) {
+      if (matchesRoot(elem.Value->haxeType, elem.Value->signature, inRoots)) {
+        pending.Push(elem.Value->signature);
+      }
+    }
+
+    while (pending.Num() > 0) {
+      auto field = pending.Pop(false);
+      if (field == nullptr || ret.Contains(field)) {
+        continue;
+      }
+      ret.Add(field);
+
+      auto ustruct = Cast<UStruct>(field);
+      if (ustruct == nullptr) {
+        continue; // enums don't reference anything
+      }
+      pending.Push(ustruct->GetSuperStruct());
+      auto uclass = Cast<UClass>(ustruct);
+      if (uclass != nullptr) {
+        for (auto& impl : uclass->Interfaces) {
+          pending.Push(impl.Class);
+        }
+      }
+
+      for (TFieldIterator<UProperty> props(ustruct, EFieldIteratorFlags::ExcludeSuper); props; ++props) {
+        addPropertyTypes(*props, pending);
+      }
+      for (TFieldIterator<UFunction> funcs(ustruct, EFieldIteratorFlags::ExcludeSuper); funcs; ++funcs) {
+        for (TFieldIterator<UProperty> args(*funcs); args; ++args) {
+          addPropertyTypes(*args, pending);
+        }
+      }
+    }
+    return ret;
+  }
+
   ModuleDescriptor *getModule(UPackage *inPackage) {
     if (m_upackageToModule.Contains(inPackage)) {
       return m_upackageToModule[inPackage];
@@ -339,10 +690,60 @@ public:
         // is enum
         this->touchEnum(uenum, inClass);
       }
+    } else if (inProp->IsA<UDelegateProperty>()) {
+      this->touchDelegate(Cast<UDelegateProperty>(inProp)->SignatureFunction, inClass);
+    } else if (inProp->IsA<UMulticastDelegateProperty>()) {
+      this->touchDelegate(Cast<UMulticastDelegateProperty>(inProp)->SignatureFunction, inClass);
     } else if (inProp->IsA<UArrayProperty>()) {
       auto prop = Cast<UArrayProperty>(inProp);
       touchProperty(prop->Inner, inClass, inMayForward);
+#if HAXE_HAS_MAP_PROPERTY
+    } else if (inProp->IsA<UMapProperty>()) {
+      auto prop = Cast<UMapProperty>(inProp);
+      touchProperty(prop->KeyProp, inClass, inMayForward);
+      touchProperty(prop->ValueProp, inClass, inMayForward);
+#endif
+#if HAXE_HAS_SET_PROPERTY
+    } else if (inProp->IsA<USetProperty>()) {
+      auto prop = Cast<USetProperty>(inProp);
+      touchProperty(prop->ElementProp, inClass, inMayForward);
+#endif
+    }
+  }
+
+  bool isClassRefReady(UClass *inClass) {
+    if (inClass == nullptr || m_classes.Contains(inClass->GetName())) {
+      return true;
     }
+    // not touched yet: we can only go on if we know it won't be touched anymore
+    auto pack = inClass->GetOuterUPackage();
+    return isExcluded(pack) || (m_upackageToModule.Contains(pack) && m_upackageToModule[pack]->isComplete());
+  }
+
+  bool isPropertyReady(UProperty *inProp) {
+    if (inProp->IsA<UClassProperty>()) {
+      auto prop = Cast<UClassProperty>(inProp);
+      return isClassRefReady(prop->MetaClass) && isClassRefReady(prop->PropertyClass);
+    } else if (inProp->IsA<HAXE_SOFT_CLASS_PROPERTY>()) {
+      auto prop = Cast<HAXE_SOFT_CLASS_PROPERTY>(inProp);
+      return isClassRefReady(prop->MetaClass) && isClassRefReady(prop->PropertyClass);
+    } else if (inProp->IsA<UObjectPropertyBase>()) {
+      return isClassRefReady(Cast<UObjectPropertyBase>(inProp)->PropertyClass);
+    } else if (inProp->IsA<UInterfaceProperty>()) {
+      return isClassRefReady(Cast<UInterfaceProperty>(inProp)->InterfaceClass);
+    } else if (inProp->IsA<UArrayProperty>()) {
+      return isPropertyReady(Cast<UArrayProperty>(inProp)->Inner);
+#if HAXE_HAS_MAP_PROPERTY
+    } else if (inProp->IsA<UMapProperty>()) {
+      auto prop = Cast<UMapProperty>(inProp);
+      return isPropertyReady(prop->KeyProp) && isPropertyReady(prop->ValueProp);
+#endif
+#if HAXE_HAS_SET_PROPERTY
+    } else if (inProp->IsA<USetProperty>()) {
+      return isPropertyReady(Cast<USetProperty>(inProp)->ElementProp);
+#endif
+    }
+    return true;
   }
 
   /**
@@ -353,6 +754,9 @@ public:
    * that has included its entire definition
    **/
   void touchStruct(UScriptStruct *inStruct, ClassDescriptor *inClass) {
+    if (isExcluded(inStruct->GetOutermost())) {
+      return;
+    }
     auto name = inStruct->GetName();
     if (!m_structs.Contains(name)) {
       m_structs.Add(name, new StructDescriptor(inStruct, this->getModule(inStruct->GetOutermost())));
@@ -381,6 +785,9 @@ public:
    * @see `touchStruct`
    **/
   void touchEnum(UEnum *inEnum, ClassDescriptor *inClass) {
+    if (isExcluded(inEnum->GetOutermost())) {
+      return;
+    }
     auto name = inEnum->GetName();
     if (!m_enums.Contains(name)) {
       m_enums.Add(name, new EnumDescriptor(inEnum, this->getModule(inEnum->GetOutermost())));
@@ -391,6 +798,28 @@ public:
       descr->addRef(inClass);
   }
 
+  /**
+   * add a reference from the class `inClass` to the delegate signature `inSignature`
+   * @see `touchStruct`
+   **/
+  void touchDelegate(UFunction *inSignature, ClassDescriptor *inClass) {
+    if (inSignature == nullptr || isExcluded(inSignature->GetOutermost())) {
+      return;
+    }
+    auto name = inSignature->GetPathName();
+    if (!m_delegates.Contains(name)) {
+      m_delegates.Add(name, new DelegateDescriptor(inSignature, this->getModule(inSignature->GetOutermost())));
+    }
+    auto descr = m_delegates[name];
+    if (inClass != nullptr)
+      descr->addRef(inClass);
+
+    for (TFieldIterator<UProperty> args(inSignature); args; ++args) {
+      // like function arguments, these may be forward declared
+      touchProperty(*args, inClass, true);
+    }
+  }
+
   ///////////////////////////////////////////////////////
   // Haxe Type handling
   ///////////////////////////////////////////////////////
@@ -469,6 +898,24 @@ public:
     return m_structs[name];
   }
 
+  const bool *findDelegateSupport(const DelegateDescriptor *inDelegate) const {
+    return m_delegateSupport.Find(inDelegate);
+  }
+
+  void setDelegateSupport(const DelegateDescriptor *inDelegate, bool inSupported) {
+    m_delegateSupport.Add(inDelegate, inSupported);
+  }
+
+  const DelegateDescriptor *getDescriptor(UFunction *inSignature) {
+    if (inSignature == nullptr) return nullptr;
+    FString name = inSignature->GetPathName();
+    if (!m_delegates.Contains(name)) {
+      return nullptr;
+    }
+
+    return m_delegates[name];
+  }
+
   TArray<const ModuleDescriptor *> getAllModules() {
     TArray<const ModuleDescriptor *> ret;
     for (auto& elem : m_upackageToModule) {
@@ -503,10 +950,62 @@ public:
     return ret;
   }
 
+  TArray<const DelegateDescriptor *> getAllDelegates() {
+    TArray<const DelegateDescriptor *> ret;
+    for (auto& elem : m_delegates) {
+      ret.Add(elem.Value);
+    }
+    return ret;
+  }
+
+  /**
+   * an estimate of the memory used by the descriptors and by the string pool
+   **/
+  FString getMemoryReport() {
+    SIZE_T classes = m_classes.GetAllocatedSize(), structs = m_structs.GetAllocatedSize(), enums = m_enums.GetAllocatedSize(),
+      delegates = m_delegates.GetAllocatedSize(), modules = m_upackageToModule.GetAllocatedSize() + m_superClasses.GetAllocatedSize();
+    for (auto& elem : m_classes) {
+      classes += elem.Key.GetAllocatedSize() + sizeof(ClassDescriptor) + elem.Value->haxeType.name.GetAllocatedSize() + elem.Value->constRefParams.GetAllocatedSize();
+    }
+    for (auto& elem : m_structs) {
+      structs += elem.Key.GetAllocatedSize() + sizeof(StructDescriptor) + elem.Value->haxeType.name.GetAllocatedSize() +
+        elem.Value->sameModuleRefs.GetAllocatedSize() + elem.Value->otherModuleRefs.GetAllocatedSize();
+    }
+    for (auto& elem : m_enums) {
+      enums += elem.Key.GetAllocatedSize() + sizeof(EnumDescriptor) + elem.Value->haxeType.name.GetAllocatedSize() +
+        elem.Value->sameModuleRefs.GetAllocatedSize() + elem.Value->otherModuleRefs.GetAllocatedSize();
+    }
+    for (auto& elem : m_delegates) {
+      delegates += elem.Key.GetAllocatedSize() + sizeof(DelegateDescriptor) + elem.Value->haxeType.name.GetAllocatedSize() +
+        elem.Value->sameModuleRefs.GetAllocatedSize() + elem.Value->otherModuleRefs.GetAllocatedSize();
+    }
+    for (auto& elem : m_upackageToModule) {
+      modules += sizeof(ModuleDescriptor) + elem.Value->headers.GetAllocatedSize() + elem.Value->getClasses().GetAllocatedSize() +
+        elem.Value->moduleName.GetAllocatedSize();
+    }
+
+    FString ret;
+    ret += FString::Printf(TEXT("%d classes: %lld bytes\n"), m_classes.Num(), (long long int) classes);
+    ret += FString::Printf(TEXT("%d structs: %lld bytes\n"), m_structs.Num(), (long long int) structs);
+    ret += FString::Printf(TEXT("%d enums: %lld bytes\n"), m_enums.Num(), (long long int) enums);
+    ret += FString::Printf(TEXT("%d delegates: %lld bytes\n"), m_delegates.Num(), (long long int) delegates);
+    ret += FString::Printf(TEXT("%d modules: %lld bytes\n"), m_upackageToModule.Num(), (long long int) modules);
+    FHaxeStringPool::get().addMemoryReport(ret);
+    return ret;
+  }
+
   ~FHaxeTypes() {
+    freeDescriptors();
+  }
+
+private:
+  void freeDescriptors() {
     for (auto& elem : m_enums) {
       delete elem.Value;
     }
+    for (auto& elem : m_delegates) {
+      delete elem.Value;
+    }
     for (auto& elem : m_structs) {
       delete elem.Value;
     }
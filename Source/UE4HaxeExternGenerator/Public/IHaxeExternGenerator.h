@@ -4,6 +4,7 @@
 #include "Modules/ModuleManager.h"
 #include <CoreUObject.h>
 #include <cstdio>
+#include "HaxeReflectionSource.h"
 
 class IHaxeExternGenerator : public IScriptGeneratorPluginInterface
 {
@@ -17,4 +18,13 @@ public:
     printf("Generator: IS AVAILABLE HAXE EXTERN GENERATOR? %d\n\n", FModuleManager::Get().IsModuleLoaded("HaxeExternGenerator"));
     return FModuleManager::Get().IsModuleLoaded("HaxeExternGenerator");
   }
+
+  /**
+   * runs the whole generation outside UHT, touching the classes from `inSource` instead of the ones UHT exports.
+   * The configuration of `inTargetName` is used. Each call starts from a clean state, so it can be called several times
+   * per process; the type descriptors of the previous call are freed.
+   * This replays a class manifest, it is not a separate reflection backend. Only the class list comes from `inSource`: properties, functions, structs and enums are still read from the loaded
+   * UObject reflection data, so the classes must be loaded by the calling process
+   **/
+  virtual void generateFrom(IHaxeReflectionSource &inSource, const FString &inPluginPath, const FString &inTargetName) = 0;
 };